@@ -0,0 +1,30 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "board.h"
+#include "search.h"
+#include <string>
+#include <vector>
+
+// Fixed-position benchmark used to compare search node counts and time between builds
+// and with individual search techniques switched off
+class Bench {
+public:
+    static void run(int depth, const std::string& feature);
+
+    static constexpr int BENCH_DEPTH = 4;
+
+private:
+    struct Result {
+        long long nodes = 0;
+        double seconds = 0.0;
+        long long pawn_probes = 0; // Pawn hash table use
+        long long pawn_hits = 0;
+    };
+
+    static Result runPositions(SearchPool& pool, int depth);
+    static bool* featureSwitch(const std::string& feature);
+    static const std::vector<std::string> positions;
+};
+
+#endif
@@ -4,9 +4,10 @@
 #include <string>
 #include <iostream>
 #include <sstream>
-#include <unordered_map>
 #include <vector>
+#include <algorithm>
 #include <random>
+#include <mutex>
 #include "move.h"
 
 typedef unsigned long long U64;
@@ -76,18 +77,36 @@ public:
 
     // Zobrist hash of the current position
     U64 hash_key;
+    // Zobrist hash of the pawns alone, the key of the pawn structure cache
+    U64 pawn_key = 0;
 
-    // History of positions and their occurrence counts
-    std::unordered_map<U64, int> repetition_counts;
+    // Piece-square score from White's point of view, middlegame and endgame values packed in one
+    // int (see makeScore in evaluation.h), and the game phase of the pieces on the board.
+    // Updated by makeMove, so the evaluation interpolates them without looking at the pieces
+    int psqt = 0;
+    int phase = 0;
 
-    // List of non-pawn move positions (only non-pawn moves are tracked)
-    std::vector<U64> non_pawn_move_history;
+    // Keys of the positions since the last irreversible move, the current one last (one per ply).
+    // A ring buffer, so copying the board does not allocate: keys more than KEY_HISTORY_SIZE plies
+    // back are overwritten, they are out of reach of the fifty-move rule anyway
+    static constexpr int KEY_HISTORY_SIZE = 128; // Must be a power of two
+    U64 key_history[KEY_HISTORY_SIZE];
+    int key_count = 0; // Keys pushed since the last irreversible move
+
+    // Plies played since the last null move (repetitions cannot be searched across it)
+    int plies_from_null = 0;
 
     // Zobrist hashing keys
     static U64 piece_keys[12][64];    // Random keys for piece positions
     static U64 side_key;              // Random key for side to move
     static U64 enpassant_keys[64];    // Random keys for en passant squares
     static U64 castling_keys[16];     // Random keys for castling rights
+    static constexpr U64 ZOBRIST_SEED = 1070372;
+
+    // Cuckoo tables of the reversible piece moves, indexed by the key difference they make
+    static constexpr int CUCKOO_SIZE = 8192;
+    static U64 cuckoo_keys[CUCKOO_SIZE];
+    static uint16_t cuckoo_moves[CUCKOO_SIZE]; // from | to << 6 | piece << 12
 
     // Constructor
     Board();
@@ -105,25 +124,63 @@ public:
 
     // Move handling
     void makeMove(const Move& move, bool switch_side = true);
+    void makeNullMove();
+    void unmakeNullMove();
 
     // Zobrist hashing methods
     void initZobristKeys();
     void computeHash();
     void updateHash(const Move& move);
 
+    // Piece-square score and phase, computePsqt after setting up the bitboards by hand
+    void computePsqt();
+    void updatePsqt(const Move& move);
+
     // Repetition and 50-move rule methods
     void updateRepetitionHistory(const Move& move);
     bool isThreefoldRepetition() const;
     bool isFiftyMoveRule() const;
+    // Repetitions for the search, ply is the distance from the root
+    bool isRepetition() const;
+    bool hasUpcomingRepetition(int ply) const;
+    // Key of the position pliesAgo plies back, pliesAgo < availableKeys()
+    U64 previousKey(int pliesAgo) const { return key_history[(key_count - 1 - pliesAgo) & (KEY_HISTORY_SIZE - 1)]; }
+    int availableKeys() const { return std::min(key_count, KEY_HISTORY_SIZE); }
 
     // Utility methods
     std::string getCastlingRightsString() const;
+    bool hasNonPawnMaterial(int side) const;
 
 private:
+    // State saved by makeNullMove so unmakeNullMove can restore it
+    int null_saved_en_passant = NO_SQUARE;
+    int null_saved_halfmove_clock = 0;
+    int null_saved_plies_from_null = 0;
+
+    static void initCuckooTables();
+
+    void pushKey(U64 key) { key_history[key_count++ & (KEY_HISTORY_SIZE - 1)] = key; }
+    void resetKeyHistory() { key_count = 0; pushKey(hash_key); }
+
     // Helper method to check if a piece is a pawn
     bool isPawnMove(int piece) const;
 };
 
+// Prefetching the child's TT cluster (and eval and pawn cache entries) right after a move is made; build with
+// "make PREFETCH=0" to measure the search without it
+#ifndef USE_PREFETCH
+#define USE_PREFETCH 1
+#endif
+
+// Starts loading the cache line of address, the access that follows later does not wait for memory
+inline void prefetch(const void* address) {
+#if USE_PREFETCH && (defined(__GNUC__) || defined(__clang__))
+    __builtin_prefetch(address);
+#else
+    (void)address;
+#endif
+}
+
 // Bit manipulation functions
 inline void set_bit(U64& bitboard, int square) {
     bitboard |= (1ULL << square);
@@ -138,10 +195,12 @@ inline void clear_bit(U64& bitboard, int square) {
 }
 
 int bitscanForward(U64 bb);
+int bitscanReverse(U64 bb);
 int countBits(U64 bb);
 
 // Additional utility functions for strings
 std::string squareToAlgebraic(int square);
+std::string toUCI2(const Move& move);
 char pieceToChar(Piece piece);
 std::string pieceToString(int piece);
 int algebraicToSquare(const std::string& algebraic);
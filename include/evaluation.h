@@ -5,10 +5,36 @@
 #include "move.h"
 #include "move_generator.h"
 #include <limits.h>
+#include <cstdint>
+
+// Middlegame and endgame values packed in one int, the endgame one in the upper 16 bits, so both
+// are added and subtracted at once
+constexpr int makeScore(int mg, int eg) {
+    return static_cast<int>(static_cast<unsigned>(eg) << 16) + mg;
+}
+inline int mgValue(int score) {
+    return static_cast<int16_t>(static_cast<uint16_t>(static_cast<unsigned>(score)));
+}
+inline int egValue(int score) {
+    return static_cast<int16_t>(static_cast<uint16_t>((static_cast<unsigned>(score) + 0x8000) >> 16));
+}
+
+// Pawn structure of a position, cached by pawn key: its score and the pawn bitboards other
+// evaluation terms reuse. Index 0 is White, 1 is Black
+struct alignas(64) PawnEntry {
+    U64 key = 0;
+    int score = 0;          // Packed middlegame/endgame, from White's point of view
+    U64 passed[2] = {};     // Passed pawns
+    U64 attacks[2] = {};    // Squares the pawns attack
+    U64 attack_span[2] = {}; // Squares the pawns could attack as they advance
+};
+
+class PawnHashTable;
 
 class Evaluation {
 public:
-    static int evaluatePosition(const Board& board);
+    // With a pawn table, the pawn structure comes from it instead of being computed
+    static int evaluatePosition(const Board& board, PawnHashTable* pawnTable = nullptr);
     static int getPieceValue(const int piece);
     static bool isIsolatedPawn(const Board& board, int square, int side);
     static bool isConnectedPawn(const Board& board, int square, int side);
@@ -17,22 +43,39 @@ public:
     static bool isCentralSquare(int square);
     
     // Piece values
-    static constexpr int KING_VALUE = 2000000;
+    static constexpr int KING_VALUE = 20000; // Only for exchanges, kings are not part of the material sum
     static constexpr int QUEEN_VALUE = 900;
     static constexpr int ROOK_VALUE = 500;
     static constexpr int BISHOP_VALUE = 300;
     static constexpr int KNIGHT_VALUE = 300;
     static constexpr int PAWN_VALUE = 100;
 
-    // Additional evaluation factors
-    static constexpr double DOUBLED_PAWN_PENALTY = -0.5;
-    static constexpr double ISOLATED_PAWN_PENALTY = -0.5;
-    static constexpr double BLOCKED_PAWN_PENALTY = -0.5;
-    static constexpr double MOBILITY_WEIGHT = 0.1;
+    // Mobility per safe square attacked, around the typical count [knight, bishop, rook, queen]
+    static constexpr int MOBILITY_WEIGHT[4] = {4, 5, 2, 1};
+    static constexpr int MOBILITY_BASE[4] = {4, 6, 7, 13};
+    // King safety: weight per attacked square of the king zone, scaled (in percent) by the attacker count
+    static constexpr int KING_ATTACK_WEIGHT[4] = {20, 20, 40, 80};
+    static constexpr int KING_ATTACKERS_SCALE[8] = {0, 0, 50, 75, 88, 94, 97, 99};
     
-    static int scorePawnStructure(const Board& board, int side);
+    // Static exchange evaluation of a move on its destination square (a quiet move starts from a gain of 0)
+    static int see(const Board& board, const Move& move);
+    static bool seeGe(const Board& board, const Move& move, int threshold);
+
+    // Packed middlegame/endgame score, passed holds the passed pawns of side
+    static int scorePawnStructure(const Board& board, int side, U64 passed);
+    static void evaluatePawns(const Board& board, PawnEntry& entry);
     static int materialScore(const Board& board);
-    static int mobilityScore(const Board& board);
+    // Mobility and king safety, from attack bitboards
+    static int activityScore(const Board& board);
+    static int activityScore(const Board& board, const PawnEntry& pawns);
+
+    // Packed piece-square values of each piece, from White's point of view (Black's are negative)
+    static int psqt[12][64];
+    // Game phase: knights and bishops count 1, rooks 2, queens 4. MAX_PHASE is the opening
+    // material, evaluations blend from the middlegame to the endgame values as the phase drops
+    static constexpr int PHASE_WEIGHT[12] = {0, 1, 1, 2, 4, 0, 0, 1, 1, 2, 4, 0};
+    static constexpr int MAX_PHASE = 24;
+    static void initPsqt();
 
 private:
     // Piece-square tables for each piece type
@@ -45,11 +88,34 @@ private:
     static const int kingEndGameTable[64];
 
     // Helper methods
-    static int pieceSquareScore(const Board& board);
-    static bool isEndGame(const Board& board);
+    static int taper(int score, int phase);
     static int mirrorSquare(int square);
+    static int leastValuableAttacker(const Board& board, U64 attackers, int side);
+    static int sideActivity(const Board& board, int side, U64 enemyPawnAttacks);
+    static U64 pawnAttackSet(const Board& board, int side);
+    static U64 forwardFill(U64 squares, int side);
 };
 
 
+// Per-thread cache of pawn structure evaluations. Pawns move rarely, so most nodes find their entry
+class PawnHashTable {
+public:
+    static constexpr int SIZE = 1 << 14; // Entries, must be a power of two
+
+    // The entry of the position's pawns, evaluated and stored first on a miss
+    const PawnEntry& probe(const Board& board);
+    void prefetch(U64 pawnKey) const;
+    void clear();
+
+    // Since the last resetStatistics()
+    long long probes() const { return probe_count; }
+    long long hits() const { return hit_count; }
+    void resetStatistics() { probe_count = 0; hit_count = 0; }
+
+private:
+    PawnEntry entries[SIZE];
+    long long probe_count = 0;
+    long long hit_count = 0;
+};
 
 #endif
@@ -0,0 +1,26 @@
+#ifndef LARGE_PAGES_H
+#define LARGE_PAGES_H
+
+#include <cstddef>
+
+// How a large table ended up being backed
+enum PageKind {
+    PAGES_NONE,        // Nothing allocated
+    PAGES_HUGETLB,     // Explicit 2 MB pages (MAP_HUGETLB), needs pages reserved by the system
+    PAGES_TRANSPARENT, // Normal mapping the kernel was asked to back with transparent huge pages
+    PAGES_NORMAL       // Plain aligned allocation
+};
+
+// Memory for the big tables (the transposition table). On multi-GB tables TLB misses dominate
+// the probes, so 2 MB pages are tried first, falling back silently to normal pages.
+// The memory is zeroed, and aligned to at least a cache line
+class LargePages {
+public:
+    static void* allocate(size_t bytes, PageKind& kind);
+    static void release(void* memory, size_t bytes, PageKind kind);
+    static const char* describe(PageKind kind);
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+};
+
+#endif
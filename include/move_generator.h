@@ -20,6 +20,8 @@ class MoveGenerator{
         static constexpr int NORTH_WEST = +7;
         static constexpr int SOUTH_EAST = -7;
         static constexpr int SOUTH_WEST = -9;
+        // Capacity that holds the pseudolegal moves of any position
+        static constexpr int MAX_MOVES = 256;
         void generatePawnMoves(const Board& board, std::vector<Move>& move_list);
         void generateKnightMoves(const Board& board, std::vector<Move>& move_list);
         void generateBishopMoves(const Board& board, std::vector<Move>& move_list);
@@ -41,6 +43,10 @@ class MoveGenerator{
             int piece_type);
         void generateAllLegalMoves(const Board& board, std::vector<Move>& move_list);
         void generateAllCaptureMoves(const Board& board, std::vector<Move>& move_list);
+        void generateQuietChecks(const Board& board, std::vector<Move>& move_list);
+        bool isPseudoLegal(const Board& board, const Move& move);
+        static bool isLegalMove(const Board& board, const Move& move);
+        static bool givesCheck(const Board& board, const Move& move);
         static bool isKingInCheck(const Board& board, int side);
         static bool isSquareAttackedByPawn(const Board& board, int square, int opponent_side);
         static bool isSquareAttackedByKnight(const Board& board, int square, int opponent_side);
@@ -52,6 +58,19 @@ class MoveGenerator{
         static bool isKnightMoveBoundaryCrossed(int from_square, int to_square);
         int getPieceOnSquare(const Board& board, int square, int opponent_side);
 
+        // Attack bitboards (sliding attacks depend on the given occupancy)
+        static U64 pawnAttacks(int side, int square);
+        static U64 knightAttacks(int square);
+        static U64 kingAttacks(int square);
+        static U64 bishopAttacks(int square, U64 occupancy);
+        static U64 rookAttacks(int square, U64 occupancy);
+        static U64 queenAttacks(int square, U64 occupancy);
+        // Pieces of both sides attacking the square, with sliders seeing through removed pieces
+        static U64 attackersTo(const Board& board, int square, U64 occupancy);
+
+    private:
+        static U64 rayAttacks(int direction, int square, U64 occupancy);
+
 };
 
 #endif
\ No newline at end of file
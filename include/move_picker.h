@@ -0,0 +1,68 @@
+#ifndef MOVE_PICKER_H
+#define MOVE_PICKER_H
+
+#include "board.h"
+#include "move.h"
+#include "move_generator.h"
+#include <cstdint>
+#include <vector>
+
+class SearchWorker;
+
+// Hands out the moves of a node one at a time, generating and scoring them in stages, so a node
+// that fails high early does not generate, check or sort the moves it never tries.
+// Main search: TT move, captures and queen promotions that do not lose material (MVV-LVA and capture
+// history), killers and countermove, quiets by history, then the captures that lose material.
+// Quiescence: TT move, captures and queen promotions, then the quiet checks if asked for. In check: TT move, then every evasion
+class MovePicker {
+public:
+    // Main search node at ply
+    MovePicker(SearchWorker& searchWorker, const Board& position, std::vector<Move>& move_list,
+               uint16_t tt_packed_move, int searchPly);
+    // Quiescence (and ProbCut) node
+    MovePicker(SearchWorker& searchWorker, const Board& position, std::vector<Move>& move_list,
+               uint16_t tt_packed_move, bool in_check, bool with_quiet_checks);
+
+    // The next move to search, false once all were handed out
+    bool next(Move& move);
+    // The quiets still to come will not be searched (late move pruning), skip generating them
+    void skipQuiets() { skip_quiets = true; }
+
+private:
+    enum Stage {
+        MAIN_TT, CAPTURE_INIT, GOOD_CAPTURE, REFUTATION, QUIET_INIT, QUIET, BAD_CAPTURE,
+        QSEARCH_TT, QCAPTURE_INIT, QCAPTURE, QCHECK_INIT, QCHECK,
+        EVASION_TT, EVASION_INIT, EVASION,
+        DONE
+    };
+
+    SearchWorker& worker;
+    const Board& board;
+    std::vector<Move>& moves; // List of the node, preallocated in the search stack
+    MoveGenerator generator;
+    int stage;
+    int ply = -1;
+    Move tt_move;             // Validated TT move, from_square -1 if there is none
+    uint16_t tt_packed = 0;
+    Move refutations[3];      // Killers and countermove
+    int refutation_count = 0;
+    int refutation_index = 0;
+    bool quiet_checks = false;
+    bool skip_quiets = false;
+    size_t current = 0;
+    size_t bad_captures_end = 0; // Captures that lose material wait in [0, bad_captures_end)
+    int scores[MoveGenerator::MAX_MOVES];
+
+    void setTTMove(uint16_t packed, bool any_move);
+    void addRefutation(const Move& move);
+    bool isTTMove(const Move& move) const;
+    bool isRefutation(const Move& move) const;
+    static bool isTactical(const Move& move); // Generated in the capture stages
+    void generate(bool tactical);
+    void scoreCaptures();
+    void scoreQuiets();
+    void scoreEvasions();
+    bool selectBest(Move& move); // Partial selection sort: swaps the best of [current, end) to current
+};
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <bitset>
+#include <string>
+#include <vector>
+
+// NUMA topology read from /sys/devices/system/node, and binding of threads to the nodes.
+// On a machine with a single node (or without the topology) binding does nothing
+class Numa {
+public:
+    // CPUs a thread may run on, by CPU number (the size of the system's cpu_set_t)
+    typedef std::bitset<1024> CpuSet;
+
+    // CPUs of each online node, read once
+    static const std::vector<std::vector<int>>& nodes();
+    static int nodeCount() { return static_cast<int>(nodes().size()); }
+    // Restricts the calling thread to the CPUs of the node, false if it was left as it was
+    static bool bindToNode(int node);
+    // Affinity of the calling thread, so a temporary binding can be undone. False if it is not available
+    static bool threadAffinity(CpuSet& cpus);
+    static bool setThreadAffinity(const CpuSet& cpus);
+    // "0-3,8-11" style lists of /sys, as numbers
+    static std::vector<int> parseList(const std::string& list);
+
+private:
+    static std::vector<std::vector<int>> readTopology();
+};
+
+#endif
@@ -5,19 +5,341 @@
 #include "move.h"
 #include "move_generator.h"
 #include "evaluation.h"
+#include "transposition_table.h"
 #include <vector>
 #include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
+// History indexed by the [piece][to] of a move, stored as int16 so the tables stay cache friendly
+typedef int16_t PieceToHistory[12][64];
+
+constexpr int MAX_SEARCH_PLY = 128;
+constexpr int MAX_TRIED_MOVES = 64; // Quiets (and captures) remembered per node for the history updates
+
+// Per-ply information kept along the current search path. The move lists are reserved once, so
+// after the worker is created the search runs without heap allocations
+struct SearchStackEntry {
+    SearchStackEntry() {
+        moves.reserve(MoveGenerator::MAX_MOVES);
+        singular_moves.reserve(MoveGenerator::MAX_MOVES);
+    }
+
+    std::vector<Move> moves;          // Moves of the node at this ply
+    std::vector<Move> singular_moves; // Moves of the singular extension search nested at this ply
+    Move killers[2];                  // Quiet moves that caused a cutoff at this ply
+    // Moves searched at this node without a cutoff, penalized in the histories when a later move cuts.
+    // The nested searches at the same ply (null move verification, singular) finish before they are filled
+    Move quiets_tried[MAX_TRIED_MOVES];
+    Move captures_tried[MAX_TRIED_MOVES];
+    int static_eval = 0;
+    bool in_check = false;
+    Move current_move; // Move being searched from this ply (NO_PIECE for a null move)
+    // Continuation history sub-table of current_move's [piece][to] (nullptr after a null move)
+    PieceToHistory* continuation_history = nullptr;
+    uint16_t excluded_move = 0; // Move left out by a singular extension search (packed, 0 for none)
+    int double_extensions = 0;  // Double extensions along the path to this ply
+    int check_extensions = 0;   // Check extensions along the path to this ply
+    Move pv[MAX_SEARCH_PLY];    // Principal variation from this ply on
+    int pv_length = 0;
+};
+
+// Limits of one search, zero means no limit
+struct SearchLimits {
+    int depth = 0;
+    long long nodes = 0;
+    long long move_time_ms = 0;
+    // Clock of each side ([WHITE] wtime/winc, [BLACK] btime/binc) and the moves until the next time control
+    long long time_ms[2] = {0, 0};
+    long long increment_ms[2] = {0, 0};
+    int moves_to_go = 0;
+    bool ponder = false;   // Searching on the opponent's time: node and time limits wait for ponderHit()
+    bool infinite = false; // The result is only returned after stop(), even if the depth limit is reached
+};
+
+// A legal root move with its score and principal variation from the last iteration that searched it
+struct RootMove {
+    RootMove(const Move& m, int initial_score) : move(m), score(initial_score), previous_score(initial_score) {}
+
+    Move move;
+    int score;
+    int previous_score; // Score of the previous iteration, the center of the aspiration window
+    Move pv[MAX_SEARCH_PLY];
+    int pv_length = 0;
+};
+
+// Shallow depth pruning thresholds, kept together so a tuner can adjust them
+struct PruningParameters {
+    // Reverse futility: prune when static eval - margin * depth is still above beta
+    int rfp_max_depth = 6;
+    int rfp_margin = 80;
+    // Futility: skip quiet moves when static eval + base + margin * depth cannot reach alpha
+    int futility_max_depth = 6;
+    int futility_base = 100;
+    int futility_margin = 100;
+    // Late move pruning: skip the remaining quiets after (base + depth^2) / (2 - improving) of them
+    int lmp_max_depth = 6;
+    int lmp_base = 3;
+    // History pruning: skip quiet moves whose continuation history is below -margin * depth
+    int history_max_depth = 3;
+    int history_margin = 64;
+    // Razoring: drop into quiescence when static eval + base + margin * depth is below alpha
+    int razor_max_depth = 3;
+    int razor_base = 100;
+    int razor_margin = 100;
+    // ProbCut: a good capture that beats beta + margin at depth - PROBCUT_REDUCTION cuts the node
+    int probcut_min_depth = 5;
+    int probcut_margin = 100;
+};
+
+// Static evaluation cached by position key
+struct EvalCacheEntry {
+    U64 key = 0;
+    int eval = 0;
+};
+
+class SearchPool;
+
+// Search parameters shared by every search: technique switches, pruning thresholds and constants
 class Search {
 public:
-    static Move findBestMove(Board& board, int depth);
-    static long long nodes_searched; // Counter for leaf nodes
+    static void init();
+
+    // Switches for the selective search techniques, so the bench can measure each one
+    static bool null_move_enabled;
+    static bool lmr_enabled;
+    static bool quiet_checks_enabled; // Quiet checks at the first quiescence ply
+    static bool rfp_enabled;
+    static bool futility_enabled;
+    static bool lmp_enabled;
+    static bool history_pruning_enabled;
+    static bool razoring_enabled;
+    static bool probcut_enabled;
+    static bool singular_enabled;
+    static bool check_extensions_enabled;
+    static bool iir_enabled;
+
+    static PruningParameters pruning;
+
+    static constexpr int MAX_PLY = MAX_SEARCH_PLY;
+
+    // Score space: evaluations stay well inside +-VALUE_MATE_IN_MAX_PLY, mate scores are
+    // VALUE_MATE minus the distance to mate in plies from the root, VALUE_INFINITE bounds everything
+    static constexpr int VALUE_MATE = 32000;
+    static constexpr int VALUE_INFINITE = 32001;
+    static constexpr int VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+    static constexpr int VALUE_MATED_IN_MAX_PLY = -VALUE_MATE_IN_MAX_PLY;
+
+    static constexpr int VALUE_DRAW = 0;
+
+    static constexpr int mateIn(int ply) { return VALUE_MATE - ply; }
+    static constexpr int matedIn(int ply) { return -VALUE_MATE + ply; }
+
+    // Null-move pruning parameters
+    static constexpr int NULL_MOVE_MIN_DEPTH = 3;           // Shallower nodes are not worth a null search
+    static constexpr int NULL_MOVE_VERIFICATION_DEPTH = 8;  // From this depth on a cutoff must be verified
+    static constexpr int PROBCUT_REDUCTION = 4;
+
+    // Singular extension parameters
+    static constexpr int SINGULAR_MIN_DEPTH = 6;
+    static constexpr int SINGULAR_MARGIN = 2;           // Per ply of depth below the TT score
+    static constexpr int DOUBLE_EXTENSION_MARGIN = 50;  // Far below the singular beta, extend twice
+    static constexpr int MAX_DOUBLE_EXTENSIONS = 1;     // Per line
+    static constexpr int MAX_CHECK_EXTENSIONS = 8;      // Per line
+
+    // Aspiration windows around the previous iteration's score
+    static constexpr int ASPIRATION_MIN_DEPTH = 4;
+    static constexpr int ASPIRATION_WINDOW = 25;
+
+    // Internal iterative reductions: nodes without a usable TT move are searched one ply shallower
+    static constexpr int IIR_MIN_DEPTH = 4;
+
+    // Keys of the searches that exclude a move, so they do not share TT entries with the full search
+    static constexpr U64 EXCLUSION_KEY = 0x9E3779B97F4A7C15ULL;
+
+    // Late move reduction parameters
+    static constexpr int MAX_DEPTH = 64;
+    static constexpr int MAX_MOVES = 256;
+    static constexpr int LMR_MIN_DEPTH = 3;
+    static constexpr int LMR_MIN_MOVE_INDEX = 3;  // The first moves of the ordering are always searched fully
+    static constexpr int LMR_HISTORY_DIVISOR = 16384;  // History adds or removes a few plies of reduction
+
+    // Quiet move ordering
+    static constexpr int MAX_HISTORY = 16384;      // History scores stay within [-MAX_HISTORY, MAX_HISTORY]
+    static constexpr int MAX_HISTORY_BONUS = 1200;
+    static constexpr int CAPTURE_SCORE = 100000;   // Ordering bands, from best to worst
+    static constexpr int PROMOTION_SCORE = 90000;
+    static constexpr int KILLER_1_SCORE = 80000;
+    static constexpr int KILLER_2_SCORE = 79000;
+    static constexpr int COUNTER_MOVE_SCORE = 78000;
+    static constexpr int BAD_CAPTURE_SCORE = -200000; // Captures losing material (SEE < 0) go after the quiets
+
+    // Quiescence search
+    static constexpr int DELTA_MARGIN = 200;
+
+    static constexpr int EVAL_CACHE_SIZE = 1 << 16; // Entries, must be a power of two
+
+    // Search output: iteration reports closer together than INFO_INTERVAL_MS are skipped (the last
+    // one is always printed), and a long iteration reports its progress every PROGRESS_INTERVAL_MS
+    static constexpr long long INFO_INTERVAL_MS = 100;
+    static constexpr long long PROGRESS_INTERVAL_MS = 1000;
+
+    // Time management: without movestogo the remaining time is shared as if MOVES_TO_GO_ESTIMATE moves
+    // were left, and MOVE_OVERHEAD_MS is kept back for the communication with the interface
+    static constexpr int MOVES_TO_GO_ESTIMATE = 30;
+    static constexpr long long MOVE_OVERHEAD_MS = 30;
+    // Held while writing a line, so the lines of the search and the UCI threads do not interleave
+    static std::mutex output_mutex;
+
+    // Base reduction for a given depth and move index, filled by init()
+    static int reductions[MAX_DEPTH][MAX_MOVES];
+};
+
+
+// One search thread: its own copy of the position, search stack, move ordering tables and node
+// counters. The pool it belongs to holds the transposition table and the limits of the search
+class SearchWorker {
+public:
+    SearchWorker(SearchPool& pool, int id);
+
+    // Iterative deepening from the position, returns the best line of the last completed iteration
+    RootMove search(const Board& board);
+    void clear(); // Forget what previous searches learned, as for a new game
+
+    long long nodes() const { return counters.nodes.load(std::memory_order_relaxed); }
+    long long qnodes() const { return counters.qnodes.load(std::memory_order_relaxed); }
+    const PawnHashTable& pawnTable() const { return pawn_table; }
+
+private:
+    friend class MovePicker; // Scores moves with the worker's heuristics
+
+    static constexpr int MAX_PLY = Search::MAX_PLY;
+
+    // Written by this worker only and summed by the pool on demand; the cache line of their own
+    // keeps the other workers' counters from bouncing it between cores
+    struct alignas(64) NodeCounters {
+        std::atomic<long long> nodes{0};  // Main search nodes
+        std::atomic<long long> qnodes{0}; // Quiescence search nodes
+    };
+
+    SearchPool& pool;
+    const int id; // 0 is the main worker, the one that checks the limits and reports
+    NodeCounters counters;
+    Board root_board;
+    std::vector<RootMove> root_moves;
+    std::vector<std::pair<int, Move>> scored_moves; // Scratch list of orderMoves
+    int root_depth = 0; // Depth of the current iteration, extensions stop at ply 2 * root_depth
+    int sel_depth = 0;  // Deepest ply reached in this search, quiescence included
+    long long start_ms = 0;     // When this search started
+    long long last_info_ms = 0; // When the last report was printed
+
+    // Search path and move ordering heuristics
+    SearchStackEntry search_stack[MAX_PLY + 1];
+    int16_t history[2][64][64];         // Butterfly history [side][from][to]
+    Move counter_moves[12][64];         // Best reply to the previous move's [piece][to]
+    // Continuation history [previous piece][previous to][piece][to], used for the moves 1, 2 and 4 plies back
+    PieceToHistory continuation_history[12][64];
+    int16_t capture_history[12][64][12];  // [piece][to][captured piece]
+    EvalCacheEntry eval_cache[Search::EVAL_CACHE_SIZE];
+    PawnHashTable pawn_table;
+
+    static void increment(std::atomic<long long>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void clearHeuristics();
+    void updateStatistics(const Board& board, const Move& bestMove, const Move* quietsTried, int quietCount,
+                          const Move* capturesTried, int captureCount, int depth, int ply);
+    void updateHistory(int side, const Move& move, int bonus);
+    void updateContinuationHistory(const Move& move, int bonus, int ply);
+    static void applyGravity(int16_t& entry, int bonus);
+    PieceToHistory* previousContinuation(int ply, int pliesBack);
+    int quietStatScore(const Board& board, const Move& move, int ply);
+    int continuationScore(const Move& move, int ply);
+    int captureStatScore(const Move& move);
+
+    static void sortRootMoves(std::vector<RootMove>::iterator first, std::vector<RootMove>::iterator last);
+    void aspirationSearch(Board& board, std::vector<RootMove>& rootMoves, int depth, int pvIndex);
+    int rootSearch(Board& board, std::vector<RootMove>& rootMoves, int depth, int alpha, int beta, int pvIndex);
+    void printInfo(const RootMove& rootMove, int depth, int multiPvLine, long long now);
+    void printProgress(long long now);
+    void printStatistics(long long now); // seldepth, nodes, nps, hashfull and time of a report
+    void updatePv(int ply, const Move& move);
+    void checkLimits();
+    int staticEval(const Board& board);
+    // The child's keys are known as soon as the move is made: start loading what its node reads first
+    void prefetch(const Board& child) const;
+    static int valueToTT(int score, int ply);
+    static int valueFromTT(int score, int ply);
+    int negamax(Board& board, int depth, int alpha, int beta, int ply, bool allow_null);
+    bool probCut(Board& board, int depth, int beta, int ply, const TTEntry* tt_entry, int& score);
+    int quiescence(Board& board, int alpha, int beta, int ply, int qply);
+    // ply < 0 scores without the quiet move heuristics
+    int scoreMove(const Move& move, const Board& board, int ply);
+    // Sorts the whole list, for the root; the other nodes go through a MovePicker
+    void orderMoves(std::vector<Move>& move_list, Board& board, int ply);
+};
+
+
+// A search instance: the workers, the transposition table they share and the limits of the running
+// search. Pools are independent of each other, so several games (or an embedding program) can each
+// own one. With more than one thread the helpers search the same tree (lazy SMP) and share what
+// they find through the table; the main worker's result is the one returned
+class SearchPool {
+public:
+    explicit SearchPool(int threads = 1);
+
+    Move findBestMove(const Board& board, int depth);
+    Move findBestMove(const Board& board, const SearchLimits& searchLimits);
+    void stop();      // The running search returns its best move so far
+    void ponderHit(); // The expected move was played, the ponder search becomes a normal search
+    void clear();     // Forget what previous searches learned, as for a new game
+    void setThreads(int threads);
+    // Pin the search threads to the NUMA nodes (worker i on node i % nodes), and create each worker on
+    // its node so its tables are local memory. Does nothing on single-node machines
+    void setNumaBinding(bool enabled);
+    int threads() const { return static_cast<int>(workers.size()); }
+    bool searching() const { return running; }
+    // Searches started so far, so another thread can wait for a search to start before stopping it
+    long long searchesStarted() const { return started; }
+
+    // Node counts of the last (or running) search, summed over the workers
+    long long nodes() const;
+    long long qnodes() const;
+    // Pawn hash table use of the last search, summed over the workers
+    long long pawnHashProbes() const;
+    long long pawnHashHits() const;
+
+    TranspositionTable tt;
+    Move ponder_move;  // Expected reply to the last best move, from its principal variation
+    int multi_pv = 1;  // Number of best lines searched and reported
+    bool report_summary = true; // Time and node count after each search (the game and the bench)
+
+    static constexpr int MAX_THREADS = 64;
+
 private:
-    static int negamax(Board& board, int depth, int alpha, int beta);
-    static int quiescence(Board& board, int alpha, int beta);
-    static int scoreMove(const Move& move, const Board& board);
-    static void orderMoves(std::vector<Move>& move_list, Board& board);
+    friend class SearchWorker;
+
+    std::vector<std::unique_ptr<SearchWorker>> workers;
+
+    // Limits of the running search; stop and ponder can be changed from other threads
+    SearchLimits limits;
+    std::atomic<bool> stop_requested{false};
+    std::atomic<bool> pondering{false};
+    std::atomic<long long> start_time_ms{0}; // Restarted on ponderhit
+    long long time_budget_ms = 0; // Time for this move, from movetime or the clock (0 for none)
+    bool time_from_clock = false; // The budget is an estimate, new iterations stop at half of it
+    std::atomic<bool> running{false};
+    std::atomic<long long> started{0};
+    bool numa_binding = true;
+
+    void bindThread(int workerId) const;
+
+    static long long timeBudget(const SearchLimits& searchLimits, int side);
+    static long long nowMs();
 };
 
 
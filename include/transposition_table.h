@@ -0,0 +1,86 @@
+#ifndef TRANSPOSITION_TABLE_H
+#define TRANSPOSITION_TABLE_H
+
+#include "board.h"
+#include "move.h"
+#include "large_pages.h"
+#include <cstdint>
+#include <vector>
+
+// Bound type of a stored score
+enum TTBound : uint8_t {
+    TT_NONE  = 0,
+    TT_UPPER = 1, // Score is at most the stored value (fail low)
+    TT_LOWER = 2, // Score is at least the stored value (fail high)
+    TT_EXACT = 3
+};
+
+// 12 bytes: the cluster index already comes from the low bits of the key, the entry only keeps the
+// upper 32 bits to tell positions of the same cluster apart. Scores and evals fit in 16 bits
+struct TTEntry {
+    uint32_t key = 0;           // Upper half of the position key
+    int16_t score = 0;
+    int16_t static_eval = 0;
+    uint16_t move = 0;          // Packed best move, 0 if none
+    int8_t depth = 0;
+    uint8_t generation_bound = 0; // Search generation in the upper 6 bits, bound in the lower 2
+
+    TTBound bound() const { return static_cast<TTBound>(generation_bound & 3); }
+    uint8_t generation() const { return generation_bound >> 2; }
+};
+
+// Entries are grouped in clusters of one cache line, a probe only touches one line
+struct alignas(64) TTCluster {
+    static constexpr int SIZE = 5;
+    TTEntry entries[SIZE];
+};
+
+static_assert(sizeof(TTEntry) == 12, "TTEntry must stay packed");
+static_assert(sizeof(TTCluster) == 64, "A cluster must fill exactly one cache line");
+
+class TranspositionTable {
+public:
+    static constexpr int DEFAULT_SIZE_MB = 16;
+    static constexpr int MAX_CLEAR_THREADS = 64;
+    static constexpr size_t MIN_CLEAR_CHUNK = 16 * 1024 * 1024; // Smaller parts are not worth a thread
+
+    TranspositionTable();
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    // Both write the whole table, split between the hardware threads (not the search threads, which
+    // default to one): clearing gigabytes on one thread takes seconds.
+    // resize returns false, keeping the current table, if the new one cannot be allocated
+    bool resize(size_t megabytes);
+    void clear();
+    void newSearch();
+
+    bool probe(U64 key, TTEntry& entry) const;
+    void prefetch(U64 key) const { ::prefetch(&clusterFor(key)); }
+    void store(U64 key, int score, int static_eval, int depth, TTBound bound, uint16_t move);
+
+    // Permille of the sampled entries written during the current search
+    int hashfull() const;
+    size_t sizeMb() const { return cluster_count * sizeof(TTCluster) / (1024 * 1024); }
+    PageKind pageKind() const { return page_kind; }
+
+    // Compact move representation: from, to and promotion piece
+    static uint16_t packMove(const Move& move);
+    static bool sameMove(const Move& move, uint16_t packed);
+    // The packed move in this position, pieces and flags read from the board (legality not checked)
+    static Move unpackMove(const Board& board, uint16_t packed);
+
+private:
+    TTCluster* clusters = nullptr; // From LargePages
+    size_t cluster_count = 0;
+    PageKind page_kind = PAGES_NONE;
+    U64 index_mask = 0;
+    uint8_t generation = 0;
+
+    static uint32_t entryKey(U64 key) { return static_cast<uint32_t>(key >> 32); }
+    TTCluster& clusterFor(U64 key) { return clusters[key & index_mask]; }
+    const TTCluster& clusterFor(U64 key) const { return clusters[key & index_mask]; }
+};
+
+#endif
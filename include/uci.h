@@ -0,0 +1,52 @@
+#ifndef UCI_H
+#define UCI_H
+
+#include "board.h"
+#include "move_generator.h"
+#include "search.h"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <sstream>
+
+// UCI command loop (uci, isready, ucinewgame, setoption, position, go, stop, ponderhit, quit).
+// The main thread only reads the commands: stop and ponderhit act on the running search at once,
+// the others are queued for the engine thread, which runs them (and the searches) in order.
+// Searches with "go depth" or "go nodes" are deterministic: the same commands give the
+// same best move, score and node count on every run
+class Uci {
+public:
+    static void loop();
+
+private:
+    // Commands read by the main thread and waiting for the engine thread
+    class CommandQueue {
+    public:
+        void push(const std::string& command);
+        std::string pop(); // Waits for the next command
+
+    private:
+        std::deque<std::string> commands;
+        std::mutex mutex;
+        std::condition_variable available;
+    };
+
+    static void engineLoop(SearchPool& pool, CommandQueue& queue);
+    static void position(Board& board, std::istringstream& command);
+    static void go(SearchPool& pool, Board& board, std::istringstream& command);
+    static void setOption(SearchPool& pool, std::istringstream& command);
+    // The value of a spin option, clamped to [min, max]. False if it is not a number
+    static bool parseSpin(const std::string& value, int min, int max, int& result);
+    static Move parseMove(const Board& board, const std::string& moveStr);
+    static void sendHashInfo(const SearchPool& pool);
+    static void send(const std::string& line); // One line to the GUI, flushed
+
+    // Bounds of the spin options, as advertised after "uci"
+    static constexpr int MAX_HASH_MB = 4096;
+    static constexpr int MAX_MULTI_PV = 64;
+
+    static constexpr const char* START_FEN = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+};
+
+#endif
@@ -2,8 +2,11 @@
 #include "move_generator.h"
 #include "move.h"
 #include "search.h"
+#include "bench.h"
+#include "uci.h"
 #include <iostream>
 #include <string>
+#include <thread>
 
 #define MAX_DEPTH 10
 #define DEFAULT_DEPTH 4
@@ -11,14 +14,49 @@
 Move fromUCI(const std::string& moveStr, const Board& board);
 std::string toUCI(const Move& move);
 bool isGameOver(Board& board, MoveGenerator moveGenerator, std::vector<Move> move_list);
+bool sameMove(const Move& a, const Move& b);
 int arg_parser(int argc, char* argv[]);
 
 
 int main(int argc, char* argv[]) {
 
+    Search::init();
+
+    // Benchmark mode: ./athena bench [depth] [feature]
+    if (argc > 1 && std::string(argv[1]) == "bench") {
+        int benchDepth = (argc > 2) ? std::atoi(argv[2]) : Bench::BENCH_DEPTH;
+        std::string feature = (argc > 3) ? argv[3] : "";
+        Bench::run(benchDepth, feature);
+        return 0;
+    }
+
+    // UCI mode, for graphical interfaces and reproducible searches (go depth / go nodes)
+    if (argc > 1 && std::string(argv[1]) == "uci") {
+        Uci::loop();
+        return 0;
+    }
+
+    // Analysis mode: ./athena analyse <depth> <lines> [fen], reports the best lines per depth
+    if (argc > 1 && std::string(argv[1]) == "analyse") {
+        int analysisDepth = (argc > 2) ? std::atoi(argv[2]) : DEFAULT_DEPTH;
+        SearchPool pool;
+        pool.multi_pv = (argc > 3) ? std::atoi(argv[3]) : 1;
+        Board board;
+        board.loadFEN((argc > 4) ? argv[4] : "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+        Move bestMove = pool.findBestMove(board, std::max(analysisDepth, 1));
+        std::cout << "bestmove " << toUCI(bestMove) << "\n";
+        return 0;
+    }
+
     // Parse the user arguments
     int depth = arg_parser(argc, argv);
 
+    // ./athena <depth> ponder [movetime_ms]: think on the human's time, optionally with a time limit per move
+    bool ponder = (argc > 2 && std::string(argv[2]) == "ponder");
+    SearchLimits limits;
+    limits.depth = depth;
+    limits.move_time_ms = (ponder && argc > 3) ? std::atoll(argv[3]) : 0;
+
 
     Board board;
     //board.resetBoard();
@@ -51,6 +89,13 @@ int main(int argc, char* argv[]) {
     }
 
     MoveGenerator moveGenerator;
+    SearchPool pool;
+
+    // Ponder search running on a background thread while the human thinks
+    std::thread ponderThread;
+    Move ponderMove;        // Human move the ponder search expects
+    Move ponderResult;      // Its best reply
+    bool ponderHit = false; // ponderResult is the engine's answer to the move just played
 
     while (true) {
         std::vector<Move> move_list;
@@ -89,6 +134,18 @@ int main(int argc, char* argv[]) {
                 continue;
             }
 
+            // The expected move turns the ponder search into the engine's search, any other move stops it
+            if (ponderThread.joinable()) {
+                ponderHit = sameMove(userMove, ponderMove);
+                if (ponderHit) {
+                    std::cout << "Engine expected this move.\n";
+                    pool.ponderHit();
+                } else {
+                    pool.stop();
+                }
+                ponderThread.join();
+            }
+
             // The user move passed the validation check, 
             // so make the move 
             board.makeMove(userMove);
@@ -107,7 +164,8 @@ int main(int argc, char* argv[]) {
         } else {
             // Engine move
             std::cout << "Engine is thinking...\n";
-            Move engineMove = Search::findBestMove(board, depth);
+            Move engineMove = ponderHit ? ponderResult : pool.findBestMove(board, limits);
+            ponderHit = false;
 
             if (engineMove.from_square == -1 || engineMove.to_square == -1) {
                 std::cout << "Engine has no legal moves. Game over!\n";
@@ -118,6 +176,18 @@ int main(int argc, char* argv[]) {
             board.makeMove(engineMove);
             board.printBoard();
 
+            // Search the expected reply from the principal variation while the human thinks
+            if (ponder && pool.ponder_move.from_square != -1) {
+                ponderMove = pool.ponder_move;
+                Board ponderBoard = board;
+                ponderBoard.makeMove(ponderMove);
+                SearchLimits ponderLimits = limits;
+                ponderLimits.ponder = true;
+                ponderThread = std::thread([ponderBoard, ponderLimits, &pool, &ponderResult]() {
+                    ponderResult = pool.findBestMove(ponderBoard, ponderLimits);
+                });
+            }
+
             // Check for draw conditions after the move
             if (board.isThreefoldRepetition()) {
                 std::cout << "Draw by threefold repetition!\n";
@@ -130,6 +200,11 @@ int main(int argc, char* argv[]) {
         }
     }
 
+    if (ponderThread.joinable()) {
+        pool.stop();
+        ponderThread.join();
+    }
+
     return 0;
 }
 
@@ -182,6 +257,10 @@ bool isGameOver(Board& board, MoveGenerator moveGenerator, std::vector<Move> mov
     return false;
 }
 
+bool sameMove(const Move& a, const Move& b) {
+    return a.from_square == b.from_square && a.to_square == b.to_square && a.promoted_piece == b.promoted_piece;
+}
+
 // Convert the move from UCI to the Move object
 Move fromUCI(const std::string& moveStr, const Board& board) {
     if (moveStr.length() < 4) return Move(-1, -1, NO_PIECE, NO_PIECE, NO_PIECE, 0); // Invalid move
@@ -0,0 +1,92 @@
+#include "bench.h"
+
+// Bench positions: opening, middlegame, tactical and endgame positions
+const std::vector<std::string> Bench::positions = {
+    "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+    "r1bqkbnr/pppp1ppp/2n5/4p3/4P3/5N2/PPPP1PPP/RNBQKB1R w KQkq - 2 3",
+    "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+    "r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8",
+    "2r3k1/pp3ppp/2n1b3/3p4/3P4/2PB1N2/P4PPP/2R3K1 w - - 0 20",
+    "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+    "4k3/8/8/3PK3/8/8/8/8 w - - 0 1",
+    "6k1/5ppp/8/8/8/8/5PPP/3R2K1 w - - 0 1"
+};
+
+
+void Bench::run(int depth, const std::string& feature) {
+    if (depth < 1) {
+        depth = BENCH_DEPTH;
+    }
+
+    bool* featureFlag = nullptr;
+    if (!feature.empty()) {
+        featureFlag = featureSwitch(feature);
+        if (featureFlag == nullptr) {
+            std::cout << "Unknown feature '" << feature << "' (expected: nullmove, lmr, qchecks, rfp, futility, lmp, history, razoring, probcut, singular, checkext, iir).\n";
+            return;
+        }
+    }
+
+    SearchPool pool; // Single threaded, so the node counts are reproducible
+    Result enabled = runPositions(pool, depth);
+    std::cout << "\n==========================\n";
+    std::cout << "Bench depth: " << depth << "\n";
+    std::cout << "Nodes searched: " << enabled.nodes << "\n";
+    std::cout << "Time: " << enabled.seconds << " seconds\n";
+    if (enabled.pawn_probes > 0) {
+        std::cout << "Pawn hash hit rate: " << 100.0 * enabled.pawn_hits / enabled.pawn_probes << "%\n";
+    }
+
+    if (featureFlag != nullptr) {
+        // Repeat the bench with the feature switched off to see its effect on the tree size
+        *featureFlag = false;
+        Result disabled = runPositions(pool, depth);
+        *featureFlag = true;
+
+        std::cout << "Nodes searched without " << feature << ": " << disabled.nodes << "\n";
+        std::cout << "Time without " << feature << ": " << disabled.seconds << " seconds\n";
+        if (disabled.nodes > 0) {
+            double reduction = 100.0 * (disabled.nodes - enabled.nodes) / disabled.nodes;
+            std::cout << "Tree size reduction from " << feature << ": " << reduction << "%\n";
+        }
+    }
+}
+
+
+Bench::Result Bench::runPositions(SearchPool& pool, int depth) {
+    Result result;
+
+    for (const std::string& fen : positions) {
+        Board board;
+        board.loadFEN(fen);
+        pool.clear(); // Every position starts from the same state, so runs can be compared
+
+        std::cout << "Position: " << fen << "\n";
+        auto start = std::chrono::high_resolution_clock::now();
+        pool.findBestMove(board, depth);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        result.nodes += pool.nodes() + pool.qnodes();
+        result.pawn_probes += pool.pawnHashProbes();
+        result.pawn_hits += pool.pawnHashHits();
+        result.seconds += std::chrono::duration<double>(end - start).count();
+    }
+    return result;
+}
+
+
+bool* Bench::featureSwitch(const std::string& feature) {
+    if (feature == "nullmove") return &Search::null_move_enabled;
+    if (feature == "lmr") return &Search::lmr_enabled;
+    if (feature == "qchecks") return &Search::quiet_checks_enabled;
+    if (feature == "rfp") return &Search::rfp_enabled;
+    if (feature == "futility") return &Search::futility_enabled;
+    if (feature == "lmp") return &Search::lmp_enabled;
+    if (feature == "history") return &Search::history_pruning_enabled;
+    if (feature == "razoring") return &Search::razoring_enabled;
+    if (feature == "probcut") return &Search::probcut_enabled;
+    if (feature == "singular") return &Search::singular_enabled;
+    if (feature == "checkext") return &Search::check_extensions_enabled;
+    if (feature == "iir") return &Search::iir_enabled;
+    return nullptr;
+}
@@ -1,4 +1,6 @@
 #include "board.h"
+#include "move_generator.h"
+#include "evaluation.h"
 
 std::string toUCI2(const Move& move) {
     std::string uci = squareToAlgebraic(move.from_square) + squareToAlgebraic(move.to_square);
@@ -82,8 +84,7 @@ void Board::makeMove(const Move& move, bool switch_side) {
     // Update occupancies
     updateOccupancies();
 
-    // Update castling rights
-    updateCastlingRights(move);
+    // (castling rights are updated by updateHash, which needs the old rights to hash them out)
 
     // Update the move number if Black has just moved
     if (side == BLACK) {
@@ -113,28 +114,61 @@ void Board::makeMove(const Move& move, bool switch_side) {
         side = (side == WHITE) ? BLACK : WHITE;
     }
 
-    // Update the hash key based on the move
+    // Update the hash key and the piece-square score based on the move
+    updatePsqt(move);
     updateHash(move);
 
     // Update the repetition history based on the move
     updateRepetitionHistory(move);
+    plies_from_null++;
+}
+
+// Pass the turn to the opponent (used by null-move pruning)
+// Only the side, the en passant square and the hash change, so it is much cheaper than makeMove
+void Board::makeNullMove() {
+    null_saved_en_passant = en_passant;
+    null_saved_halfmove_clock = halfmove_clock;
+    null_saved_plies_from_null = plies_from_null;
+
+    if (en_passant != NO_SQUARE) {
+        hash_key ^= enpassant_keys[en_passant];
+        en_passant = NO_SQUARE;
+    }
+
+    halfmove_clock++;
+    side = (side == WHITE) ? BLACK : WHITE;
+    hash_key ^= side_key;
+
+    pushKey(hash_key);
+    plies_from_null = 0;
+}
+
+void Board::unmakeNullMove() {
+    side = (side == WHITE) ? BLACK : WHITE;
+    hash_key ^= side_key;
+
+    en_passant = null_saved_en_passant;
+    if (en_passant != NO_SQUARE) {
+        hash_key ^= enpassant_keys[en_passant];
+    }
+
+    halfmove_clock = null_saved_halfmove_clock;
+    plies_from_null = null_saved_plies_from_null;
+    key_count--;
 }
 
 
 // Set an empty board
 void Board::resetBoard() {
+    // Initialize the zobrist keys for the 3 fold repetition and the transposition table
+    initZobristKeys();
+
     // FEN for the initial position
     loadFEN("8/8/8/8/8/8/8/8 w - - 0 1");
 
     // Update occupancies
     updateOccupancies();
 
-    // Initialize the zobrist keys for the 3 fold repetition
-    initZobristKeys();
-
-    // Compute the initial Zobrist hash
-    computeHash();
-    
     // No en passant square initially
     en_passant = -1;
 
@@ -146,9 +180,12 @@ void Board::resetBoard() {
     halfmove_clock = 0;
     move_number = 1;
 
+    // Compute the initial Zobrist hash and piece-square score
+    computeHash();
+    computePsqt();
+
     // Clear the repetition history
-    repetition_counts.clear();
-    non_pawn_move_history.clear();
+    resetKeyHistory();
 
 }
 
@@ -318,6 +355,12 @@ void Board::loadFEN(const std::string& fen) {
 
     // Update occupancies
     updateOccupancies();
+
+    // Hash and piece-square score of the new position
+    computeHash();
+    computePsqt();
+    resetKeyHistory();
+    plies_from_null = 0;
 }
 
 std::string Board::generateFEN() const {
@@ -405,6 +448,19 @@ int bitscanForward(U64 b) {
     #endif
 }
 
+// Find the index of the most significant 1 bit in b
+int bitscanReverse(U64 b) {
+    #if defined(__GNUC__) || defined(__clang__)
+        return 63 - __builtin_clzll(b);
+    #else
+        int index = 0;
+        while (b >>= 1) {
+            index++;
+        }
+        return index;
+    #endif
+}
+
 // Count the number of 1 bits in b (population count)
 int countBits(U64 b) {
     #if defined(__GNUC__) || defined(__clang__)
@@ -492,54 +548,93 @@ std::string Board::getCastlingRightsString() const {
     return rights.empty() ? "None" : rights;
 }
 
+// True if the side has any piece other than pawns and the king
+bool Board::hasNonPawnMaterial(int side) const {
+    if (side == WHITE) {
+        return bitboards[WHITE_KNIGHT] | bitboards[WHITE_BISHOP] | bitboards[WHITE_ROOK] | bitboards[WHITE_QUEEN];
+    }
+    return bitboards[BLACK_KNIGHT] | bitboards[BLACK_BISHOP] | bitboards[BLACK_ROOK] | bitboards[BLACK_QUEEN];
+}
+
 // Static member definitions
 U64 Board::piece_keys[12][64];
 U64 Board::side_key;
 U64 Board::enpassant_keys[64];
 U64 Board::castling_keys[16];
+U64 Board::cuckoo_keys[CUCKOO_SIZE];
+uint16_t Board::cuckoo_moves[CUCKOO_SIZE];
 
+// The keys are shared by every board, so they are generated only once: hashes of
+// different boards (and of boards created during a search) must stay comparable
 void Board::initZobristKeys() {
-    std::mt19937_64 rng(std::random_device{}());
-    std::uniform_int_distribution<U64> dist(0, UINT64_MAX);
+    static std::once_flag keys_generated;
+    std::call_once(keys_generated, []() {
+        // Fixed seed: the same keys on every run and machine, so searches can be reproduced exactly
+        std::mt19937_64 rng(ZOBRIST_SEED);
+        std::uniform_int_distribution<U64> dist(0, UINT64_MAX);
+
+        // Initialize piece keys
+        for (int piece = 0; piece < 12; ++piece) {
+            for (int square = 0; square < 64; ++square) {
+                piece_keys[piece][square] = dist(rng);
+            }
+        }
+
+        // Key initializations
+        side_key = dist(rng);
 
-    // Initialize piece keys
-    for (int piece = 0; piece < 12; ++piece) {
         for (int square = 0; square < 64; ++square) {
-            piece_keys[piece][square] = dist(rng);
+            enpassant_keys[square] = dist(rng);
         }
-    }
 
-    // Key initializations
-    side_key = dist(rng);
-
-    for (int square = 0; square < 64; ++square) {
-        enpassant_keys[square] = dist(rng);
-    }
+        for (int i = 0; i < 16; ++i) {
+            castling_keys[i] = dist(rng);
+        }
 
-    for (int i = 0; i < 16; ++i) {
-        castling_keys[i] = dist(rng);
-    }
+        initCuckooTables();
+    });
 }
 
 
 void Board::updateHash(const Move& move) {
     // Remove moving piece from from_square
     hash_key ^= piece_keys[move.piece][move.from_square];
+    if (isPawnMove(move.piece)) {
+        pawn_key ^= piece_keys[move.piece][move.from_square];
+    }
 
     // Remove captured piece (if any)
     if (move.flags & FLAG_CAPTURE) {
-        hash_key ^= piece_keys[move.captured_piece][move.to_square];
+        int captured_square = move.to_square;
+        if (move.flags & FLAG_EN_PASSANT) {
+            // The captured pawn stands next to the capturing pawn, on the rank it started from
+            captured_square = (move.from_square & ~7) | (move.to_square & 7);
+        }
+        hash_key ^= piece_keys[move.captured_piece][captured_square];
+        if (isPawnMove(move.captured_piece)) {
+            pawn_key ^= piece_keys[move.captured_piece][captured_square];
+        }
     }
 
     // Handle promotions
     if (move.flags & FLAG_PROMOTION) {
-        // Remove pawn from to_square
-        hash_key ^= piece_keys[move.piece][move.to_square];
         // Add promoted piece to to_square
         hash_key ^= piece_keys[move.promoted_piece][move.to_square];
     } else {
         // Add moving piece to to_square
         hash_key ^= piece_keys[move.piece][move.to_square];
+        if (isPawnMove(move.piece)) {
+            pawn_key ^= piece_keys[move.piece][move.to_square];
+        }
+    }
+
+    // The rook also moves when castling
+    if (move.flags & FLAG_CASTLING) {
+        int rook = (move.piece == WHITE_KING) ? WHITE_ROOK : BLACK_ROOK;
+        int rook_from = (move.to_square > move.from_square) ? move.from_square + 3 : move.from_square - 4;
+        int rook_to = (move.to_square > move.from_square) ? move.from_square + 1 : move.from_square - 1;
+        hash_key ^= piece_keys[rook][rook_from];
+        hash_key ^= piece_keys[rook][rook_to];
     }
 
     // Handle en passant
@@ -576,10 +671,57 @@ void Board::updateHash(const Move& move) {
 
 
 
+// Same moves of pieces as updateHash, on the piece-square score and the phase
+void Board::updatePsqt(const Move& move) {
+    psqt -= Evaluation::psqt[move.piece][move.from_square];
+
+    if (move.flags & FLAG_CAPTURE) {
+        int captured_square = move.to_square;
+        if (move.flags & FLAG_EN_PASSANT) {
+            captured_square = (move.from_square & ~7) | (move.to_square & 7);
+        }
+        psqt -= Evaluation::psqt[move.captured_piece][captured_square];
+        phase -= Evaluation::PHASE_WEIGHT[move.captured_piece];
+    }
+
+    if (move.flags & FLAG_PROMOTION) {
+        psqt += Evaluation::psqt[move.promoted_piece][move.to_square];
+        phase += Evaluation::PHASE_WEIGHT[move.promoted_piece];
+    } else {
+        psqt += Evaluation::psqt[move.piece][move.to_square];
+    }
+
+    if (move.flags & FLAG_CASTLING) {
+        int rook = (move.piece == WHITE_KING) ? WHITE_ROOK : BLACK_ROOK;
+        int rook_from = (move.to_square > move.from_square) ? move.from_square + 3 : move.from_square - 4;
+        int rook_to = (move.to_square > move.from_square) ? move.from_square + 1 : move.from_square - 1;
+        psqt += Evaluation::psqt[rook][rook_to] - Evaluation::psqt[rook][rook_from];
+    }
+}
+
+void Board::computePsqt() {
+    psqt = 0;
+    phase = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        U64 bitboard = bitboards[piece];
+        while (bitboard) {
+            int square = bitscanForward(bitboard);
+            psqt += Evaluation::psqt[piece][square];
+            phase += Evaluation::PHASE_WEIGHT[piece];
+            bitboard &= bitboard - 1;
+        }
+    }
+}
+
+
+// The current position occurred at least three times since the last irreversible move
 bool Board::isThreefoldRepetition() const {
-    auto it = repetition_counts.find(hash_key);
-    if (it != repetition_counts.end()) {
-        return it->second >= 3;
+    int end = std::min(halfmove_clock, availableKeys() - 1);
+    int count = 0;
+    for (int i = 0; i <= end; i += 2) {
+        if (previousKey(i) == hash_key && ++count >= 3) {
+            return true;
+        }
     }
     return false;
 }
@@ -590,6 +732,7 @@ bool Board::isPawnMove(int piece) const {
 
 void Board::computeHash() {
     hash_key = 0ULL;
+    pawn_key = 0ULL;
 
     // Piece positions
     for (int piece = 0; piece < 12; ++piece) {
@@ -597,6 +740,9 @@ void Board::computeHash() {
         while (bitboard) {
             int square = bitscanForward(bitboard);
             hash_key ^= piece_keys[piece][square];
+            if (isPawnMove(piece)) {
+                pawn_key ^= piece_keys[piece][square];
+            }
             bitboard &= bitboard - 1; // Remove LSB
         }
     }
@@ -616,17 +762,123 @@ void Board::computeHash() {
 }
 
 void Board::updateRepetitionHistory(const Move& move) {
-    if (isPawnMove(move.piece)) {
-        // If a pawn was moved, clear the repetition history
-        non_pawn_move_history.clear();
-        repetition_counts.clear();
-    } else {
-        // Add the current hash_key to the history
-        non_pawn_move_history.push_back(hash_key);
-        repetition_counts[hash_key]++;
+    // No position before an irreversible move can come back
+    if (isPawnMove(move.piece) || (move.flags & FLAG_CAPTURE)) {
+        key_count = 0;
     }
+    pushKey(hash_key);
 }
 
 bool Board::isFiftyMoveRule() const {
     return halfmove_clock >= 100;
 }
+
+
+////////////////////////////////////////
+/// Repetition detection for search ///
+////////////////////////////////////////
+
+static inline int cuckooH1(U64 key) {
+    return key & (Board::CUCKOO_SIZE - 1);
+}
+
+static inline int cuckooH2(U64 key) {
+    return (key >> 16) & (Board::CUCKOO_SIZE - 1);
+}
+
+// Squares a non-pawn piece attacks from the square, sliders stop at the first piece of the occupancy
+static U64 pieceAttacks(int piece, int square, U64 occupancy) {
+    switch (piece % 6) {
+        case WHITE_KNIGHT: return MoveGenerator::knightAttacks(square);
+        case WHITE_BISHOP: return MoveGenerator::bishopAttacks(square, occupancy);
+        case WHITE_ROOK:   return MoveGenerator::rookAttacks(square, occupancy);
+        case WHITE_QUEEN:  return MoveGenerator::queenAttacks(square, occupancy);
+        case WHITE_KING:   return MoveGenerator::kingAttacks(square);
+        default:           return 0ULL;
+    }
+}
+
+// Store every reversible piece move (a piece going between two squares on an empty board) under the
+// key difference it makes, in a cuckoo hash table with two slots per key (Marcel van Kervinck's scheme)
+void Board::initCuckooTables() {
+    for (int piece = 0; piece < 12; ++piece) {
+        if (piece == WHITE_PAWN || piece == BLACK_PAWN) {
+            continue;
+        }
+        for (int from = 0; from < 64; ++from) {
+            for (int to = from + 1; to < 64; ++to) {
+                if (!(pieceAttacks(piece, from, 0ULL) & (1ULL << to))) {
+                    continue;
+                }
+
+                U64 key = piece_keys[piece][from] ^ piece_keys[piece][to] ^ side_key;
+                uint16_t move = from | (to << 6) | (piece << 12);
+                int slot = cuckooH1(key);
+
+                // Insert, moving the entry already in the slot to its other slot until one is free
+                while (true) {
+                    std::swap(cuckoo_keys[slot], key);
+                    std::swap(cuckoo_moves[slot], move);
+                    if (move == 0) {
+                        break;
+                    }
+                    slot = (slot == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                }
+            }
+        }
+    }
+}
+
+// The current position already occurred since the last irreversible move (a draw for the search)
+bool Board::isRepetition() const {
+    int end = std::min(std::min(halfmove_clock, plies_from_null), availableKeys() - 1);
+
+    for (int i = 4; i <= end; i += 2) {
+        if (previousKey(i) == hash_key) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// A single reversible move of the side to move leads back to an earlier position, so it can force a draw.
+// Positions before the root only count if they were already repeated
+bool Board::hasUpcomingRepetition(int ply) const {
+    int end = std::min(std::min(halfmove_clock, plies_from_null), availableKeys() - 1);
+    if (end < 3) {
+        return false;
+    }
+
+    for (int i = 3; i <= end; i += 2) {
+        U64 earlier_key = previousKey(i);
+        U64 move_key = hash_key ^ earlier_key;
+
+        int slot = cuckooH1(move_key);
+        if (cuckoo_keys[slot] != move_key) {
+            slot = cuckooH2(move_key);
+            if (cuckoo_keys[slot] != move_key) {
+                continue;
+            }
+        }
+
+        uint16_t move = cuckoo_moves[slot];
+        int from = move & 63;
+        int to = (move >> 6) & 63;
+        int piece = move >> 12;
+
+        // The squares between must be empty for the move to be playable
+        if (!(pieceAttacks(piece, from, occupancies[BOTH]) & (1ULL << to))) {
+            continue;
+        }
+
+        if (ply > i) {
+            return true;
+        }
+        for (int j = i + 4; j <= end; j += 2) {
+            if (previousKey(j) == earlier_key) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
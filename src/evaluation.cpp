@@ -91,26 +91,34 @@ const int Evaluation::kingEndGameTable[64] = {
 };
 
 
-int Evaluation::evaluatePosition(const Board& board){
+int Evaluation::psqt[12][64];
+
+// Filled before main, like the attack tables of the move generator: boards made from then on use them
+static const struct PsqtInitializer {
+    PsqtInitializer() { Evaluation::initPsqt(); }
+} psqt_initializer;
+
+
+int Evaluation::evaluatePosition(const Board& board, PawnHashTable* pawnTable) {
     int whoToMove = (board.side == WHITE) ? 1 : -1;
-    
-    MoveGenerator moveGenerator;
-    std::vector<Move> kingMoves;
-    moveGenerator.generateEnemyKingMoves(board, kingMoves);
-    if(kingMoves.empty() && moveGenerator.isKingInCheck(board, board.side)){
-        return INT_MAX;
-    }
 
+    // Checkmate and stalemate are scored by the search, which knows the distance to mate
+
+    PawnEntry computed;
+    if (pawnTable == nullptr) {
+        evaluatePawns(board, computed);
+    }
+    const PawnEntry& pawns = pawnTable ? pawnTable->probe(board) : computed;
 
     int material = materialScore(board);
-    int pawnStructure = scorePawnStructure(board, whoToMove);
-    int mobility = mobilityScore(board);
-    int positional = pieceSquareScore(board);
+    int activity = activityScore(board, pawns);
+    // Piece-square and pawn structure scores, both kept as middlegame/endgame pairs
+    int positional = taper(board.psqt + pawns.score, board.phase);
 
     if(board.DRAW == 1){
         return 0;
     }
-    int totalScore = material + pawnStructure + mobility + positional;
+    int totalScore = material + activity + positional;
 
     // Return the evaluation relative to the side to move
     return totalScore * whoToMove;
@@ -119,7 +127,6 @@ int Evaluation::evaluatePosition(const Board& board){
 int Evaluation::materialScore(const Board& board) {
     int score = 0;
 
-    score += KING_VALUE * (countBits(board.bitboards[WHITE_KING]) - countBits(board.bitboards[BLACK_KING]));
     score += QUEEN_VALUE * (countBits(board.bitboards[WHITE_QUEEN]) - countBits(board.bitboards[BLACK_QUEEN]));
     score += ROOK_VALUE * (countBits(board.bitboards[WHITE_ROOK]) - countBits(board.bitboards[BLACK_ROOK]));
     score += BISHOP_VALUE * (countBits(board.bitboards[WHITE_BISHOP]) - countBits(board.bitboards[BLACK_BISHOP]));
@@ -161,22 +168,22 @@ int Evaluation::getPieceValue(const int piece) {
 }
 
 
-int Evaluation::scorePawnStructure(const Board& board, int side) {
+int Evaluation::scorePawnStructure(const Board& board, int side, U64 passed) {
     U64 pawns = board.bitboards[side == WHITE ? WHITE_PAWN : BLACK_PAWN];
     int score = 0;
 
     U64 tempPawns = pawns; 
     while (tempPawns) {
         int square = bitscanForward(tempPawns); // get the index for the LSB
-        int rank = square / 8;
+        int rank = (side == WHITE) ? square / 8 : 7 - square / 8; // Ranks advanced from the own side
 
         // Central Pawn Bonus
         if (isCentralSquare(square)) {
-            score += PAWN_CENTER_CONTROL_BONUS;
+            score += makeScore(PAWN_CENTER_CONTROL_BONUS, PAWN_CENTER_CONTROL_BONUS);
         }
 
         // Passed Pawn
-        if (isPassedPawn(board, square, side)) {
+        if (get_bit(passed, square)) {
             int bonus = PASSED_PAWN_BONUS[rank];
             if (isConnectedPawn(board, square, side)) {
                 bonus += CONNECTED_PASSED_PAWN_BONUS;
@@ -184,15 +191,15 @@ int Evaluation::scorePawnStructure(const Board& board, int side) {
             if (isIsolatedPawn(board, square, side)) {
                 bonus = static_cast<int>(bonus * 0.85); // Apply isolation factor
             }
-            score += bonus;
+            score += makeScore(bonus, bonus);
         } else {
             // Isolated Pawn Penalty
             if (isIsolatedPawn(board, square, side)) {
-                score += ISOLATED_PAWN_PENALTY;
+                score += makeScore(ISOLATED_PAWN_PENALTY, ISOLATED_PAWN_PENALTY);
             }
             // Doubled Pawn Penalty
             if (isDoubledPawn(board, square, side)) {
-                score += DOUBLED_PAWN_PENALTY;
+                score += makeScore(DOUBLED_PAWN_PENALTY, DOUBLED_PAWN_PENALTY);
             }
         }
         clear_bit(tempPawns, square); // remove the LSB and continue the loop
@@ -201,6 +208,29 @@ int Evaluation::scorePawnStructure(const Board& board, int side) {
     return score;
 }
 
+// Everything of the pawn structure that depends on the pawns alone
+void Evaluation::evaluatePawns(const Board& board, PawnEntry& entry) {
+    entry.key = board.pawn_key;
+
+    U64 fileSpan[2];
+    for (int side = WHITE; side <= BLACK; ++side) {
+        U64 pawns = board.bitboards[side == WHITE ? WHITE_PAWN : BLACK_PAWN];
+        entry.attacks[side] = pawnAttackSet(board, side);
+        entry.attack_span[side] = forwardFill(entry.attacks[side], side);
+        fileSpan[side] = forwardFill((side == WHITE) ? pawns << 8 : pawns >> 8, side);
+    }
+
+    // A pawn is passed when no enemy pawn stands ahead of it on its file or an adjacent one,
+    // that is when it is outside the enemy file and attack spans
+    for (int side = WHITE; side <= BLACK; ++side) {
+        U64 pawns = board.bitboards[side == WHITE ? WHITE_PAWN : BLACK_PAWN];
+        entry.passed[side] = pawns & ~(fileSpan[!side] | entry.attack_span[!side]);
+    }
+
+    entry.score = scorePawnStructure(board, WHITE, entry.passed[WHITE])
+                - scorePawnStructure(board, BLACK, entry.passed[BLACK]);
+}
+
 
 bool Evaluation::isCentralSquare(int square) {
     // (for now): maybe in the future give slight bonus to C and F file?
@@ -269,140 +299,262 @@ bool Evaluation::isDoubledPawn(const Board& board, int square, int side) {
 }
 
 
-int Evaluation::mobilityScore(const Board& board) {
-    MoveGenerator moveGenerator;
-    std::vector<Move> whiteMoves, blackMoves;
-
-    // Create a copy of the board for each side's mobility
-    Board whiteBoard = board;
-    whiteBoard.side = WHITE;
-    moveGenerator.generateAllLegalMoves(whiteBoard, whiteMoves);
+// Mobility and king safety of both sides, from the attack bitboards of the pieces (no move generation)
+int Evaluation::activityScore(const Board& board) {
+    PawnEntry pawns;
+    evaluatePawns(board, pawns);
+    return activityScore(board, pawns);
+}
 
-    Board blackBoard = board;
-    blackBoard.side = BLACK;
-    moveGenerator.generateAllLegalMoves(blackBoard, blackMoves);
+int Evaluation::activityScore(const Board& board, const PawnEntry& pawns) {
+    return sideActivity(board, WHITE, pawns.attacks[BLACK]) - sideActivity(board, BLACK, pawns.attacks[WHITE]);
+}
 
-    int whiteMobility = whiteMoves.size();
-    int blackMobility = blackMoves.size();
+// Squares attacked by the pawns of side
+U64 Evaluation::pawnAttackSet(const Board& board, int side) {
+    if (side == WHITE) {
+        U64 pawns = board.bitboards[WHITE_PAWN];
+        return ((pawns & ~FILE_H) << 9) | ((pawns & ~FILE_A) << 7);
+    }
+    U64 pawns = board.bitboards[BLACK_PAWN];
+    return ((pawns & ~FILE_A) >> 9) | ((pawns & ~FILE_H) >> 7);
+}
 
-    return static_cast<int>(MOBILITY_WEIGHT * (whiteMobility - blackMobility));
+// The squares, and all the squares in front of them towards the promotion rank of side
+U64 Evaluation::forwardFill(U64 squares, int side) {
+    for (int shift = 8; shift <= 32; shift *= 2) {
+        squares |= (side == WHITE) ? squares << shift : squares >> shift;
+    }
+    return squares;
 }
 
+// Each knight, bishop, rook and queen of side scores the safe squares it attacks (not taken by its
+// own pieces nor attacked by enemy pawns) and the squares it attacks around the enemy king.
+// King pressure only counts with two attackers or more, and grows with their number
+int Evaluation::sideActivity(const Board& board, int side, U64 enemyPawnAttacks) {
+    int first = (side == WHITE) ? WHITE_KNIGHT : BLACK_KNIGHT;
+    U64 enemyKing = board.bitboards[(side == WHITE) ? BLACK_KING : WHITE_KING];
+    U64 kingZone = enemyKing ? MoveGenerator::kingAttacks(bitscanForward(enemyKing)) | enemyKing : 0ULL;
+    U64 safe = ~board.occupancies[side] & ~enemyPawnAttacks;
+    U64 occupancy = board.occupancies[BOTH];
+
+    int mobility = 0;
+    int kingAttackers = 0;
+    int kingAttackWeight = 0;
+    for (int type = 0; type < 4; ++type) { // Knight, bishop, rook, queen
+        U64 pieces = board.bitboards[first + type];
+        while (pieces) {
+            int square = bitscanForward(pieces);
+            clear_bit(pieces, square);
+
+            U64 attacks;
+            switch (type) {
+                case 0:  attacks = MoveGenerator::knightAttacks(square); break;
+                case 1:  attacks = MoveGenerator::bishopAttacks(square, occupancy); break;
+                case 2:  attacks = MoveGenerator::rookAttacks(square, occupancy); break;
+                default: attacks = MoveGenerator::queenAttacks(square, occupancy); break;
+            }
+            mobility += MOBILITY_WEIGHT[type] * (countBits(attacks & safe) - MOBILITY_BASE[type]);
 
-int Evaluation::pieceSquareScore(const Board& board) {
-    int score = 0;
-    bool endGame = isEndGame(board);
-
-    // Score white pieces
-    for (int piece = WHITE_PAWN; piece <= WHITE_KING; ++piece) {
-        U64 bitboard = board.bitboards[piece];
-        while (bitboard) {
-            int square = bitscanForward(bitboard);
-            clear_bit(bitboard, square);
-
-            switch (piece) {
-                case WHITE_PAWN:
-                    score += pawnTable[square];
-                    break;
-                case WHITE_KNIGHT:
-                    score += knightTable[square];
-                    break;
-                case WHITE_BISHOP:
-                    score += bishopTable[square];
-                    break;
-                case WHITE_ROOK:
-                    score += rookTable[square];
-                    break;
-                case WHITE_QUEEN:
-                    score += queenTable[square];
-                    break;
-                case WHITE_KING:
-                    if (endGame) {
-                        score += kingEndGameTable[square];
-                    } else {
-                        score += kingMiddleGameTable[square];
-                    }
-                    break;
+            if (attacks & kingZone) {
+                kingAttackers++;
+                kingAttackWeight += KING_ATTACK_WEIGHT[type] * countBits(attacks & kingZone);
             }
         }
     }
 
-    // Score black pieces
-    for (int piece = BLACK_PAWN; piece <= BLACK_KING; ++piece) {
-        U64 bitboard = board.bitboards[piece];
-        while (bitboard) {
-            int square = bitscanForward(bitboard);
-            clear_bit(bitboard, square);
-
-            int mirroredSquare = mirrorSquare(square);
-
-            switch (piece) {
-                case BLACK_PAWN:
-                    score -= pawnTable[mirroredSquare];
-                    break;
-                case BLACK_KNIGHT:
-                    score -= knightTable[mirroredSquare];
-                    break;
-                case BLACK_BISHOP:
-                    score -= bishopTable[mirroredSquare];
-                    break;
-                case BLACK_ROOK:
-                    score -= rookTable[mirroredSquare];
-                    break;
-                case BLACK_QUEEN:
-                    score -= queenTable[mirroredSquare];
-                    break;
-                case BLACK_KING:
-                    if (endGame) {
-                        score -= kingEndGameTable[mirroredSquare];
-                    } else {
-                        score -= kingMiddleGameTable[mirroredSquare];
-                    }
-                    break;
-            }
+    int kingPressure = kingAttackWeight * KING_ATTACKERS_SCALE[std::min(kingAttackers, 7)] / 100;
+    return mobility + kingPressure;
+}
+
+
+// Blend of the middlegame and endgame values of a packed score by the phase, so the evaluation does
+// not jump when pieces come off
+int Evaluation::taper(int score, int phase) {
+    phase = std::min(phase, MAX_PHASE); // Promotions can take it past the opening
+    return (mgValue(score) * phase + egValue(score) * (MAX_PHASE - phase)) / MAX_PHASE;
+}
+
+// The tables are from White's side, Black's pieces use the mirrored square. Only the king has
+// different middlegame and endgame tables
+void Evaluation::initPsqt() {
+    const int* tables[6] = {pawnTable, knightTable, bishopTable, rookTable, queenTable, kingMiddleGameTable};
+    for (int type = 0; type < 6; ++type) {
+        for (int square = 0; square < 64; ++square) {
+            int mirrored = mirrorSquare(square);
+            int whiteEg = (type == 5) ? kingEndGameTable[square] : tables[type][square];
+            int blackEg = (type == 5) ? kingEndGameTable[mirrored] : tables[type][mirrored];
+            psqt[type][square] = makeScore(tables[type][square], whiteEg);
+            psqt[type + 6][square] = -makeScore(tables[type][mirrored], blackEg);
         }
     }
+}
 
-    return score;
+int Evaluation::mirrorSquare(int square) {
+    int rank = square / 8;
+    int file = square % 8;
+    // Mirror the rank (0 becomes 7, 1 becomes 6, ..., 7 becomes 0)
+    int mirroredRank = 7 - rank;
+    return mirroredRank * 8 + file;
 }
 
 
-bool Evaluation::isEndGame(const Board& board) {
-    int totalMaterial = 0;
+/////////////////////
+// Pawn hash table //
+/////////////////////
 
-    // Exclude pawns and kings 
-    // White minor and major pieces 
-    for (int piece = WHITE_KNIGHT; piece <= WHITE_QUEEN; ++piece) {
-        int count = countBits(board.bitboards[piece]);
-        int pieceValue = getPieceValue(piece);
-        totalMaterial += count * pieceValue;
+const PawnEntry& PawnHashTable::probe(const Board& board) {
+    PawnEntry& entry = entries[board.pawn_key & (SIZE - 1)];
+    probe_count++;
+    if (entry.key == board.pawn_key) {
+        hit_count++;
+    } else {
+        Evaluation::evaluatePawns(board, entry);
     }
+    return entry;
+}
 
-    // Black minor and major pieces 
-    for (int piece = BLACK_KNIGHT; piece <= BLACK_QUEEN; ++piece) {
-        int count = countBits(board.bitboards[piece]);
-        int pieceValue = getPieceValue(piece);
-        totalMaterial += count * pieceValue;
+void PawnHashTable::prefetch(U64 pawnKey) const {
+    ::prefetch(&entries[pawnKey & (SIZE - 1)]);
+}
+
+void PawnHashTable::clear() {
+    std::fill(entries, entries + SIZE, PawnEntry());
+    resetStatistics();
+}
+
+
+////////////////////////////////
+// Static exchange evaluation //
+////////////////////////////////
+
+// Piece (of the given side) among the attackers with the lowest value, NO_PIECE if there is none
+int Evaluation::leastValuableAttacker(const Board& board, U64 attackers, int side) {
+    int first = (side == WHITE) ? WHITE_PAWN : BLACK_PAWN;
+    for (int piece = first; piece <= first + 5; ++piece) {
+        if (attackers & board.bitboards[piece]) {
+            return piece;
+        }
+    }
+    return NO_PIECE;
+}
+
+// Material balance of the exchange sequence started by the move, where both sides always
+// recapture with their least valuable attacker and may stop when continuing loses material.
+// Removing each capturer from the occupancy lets the sliders behind it join in (x-rays)
+int Evaluation::see(const Board& board, const Move& move) {
+    if (move.flags & FLAG_CASTLING) {
+        return 0;
+    }
+
+    int to = move.to_square;
+    U64 diagonal = board.bitboards[WHITE_BISHOP] | board.bitboards[BLACK_BISHOP]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+    U64 straight = board.bitboards[WHITE_ROOK] | board.bitboards[BLACK_ROOK]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+
+    int gain[32];
+    int count = 0;
+    gain[0] = (move.captured_piece == NO_PIECE) ? 0 : getPieceValue(move.captured_piece); // Quiet moves can still hang the piece
+
+    U64 occupancy = board.occupancies[BOTH] ^ (1ULL << move.from_square);
+    if (move.flags & FLAG_EN_PASSANT) {
+        occupancy ^= 1ULL << ((move.from_square & ~7) | (to & 7));
+    }
+    U64 attackers = MoveGenerator::attackersTo(board, to, occupancy) & occupancy;
+    int pieceOnSquare = (move.promoted_piece != NO_PIECE) ? move.promoted_piece : move.piece;
+    int side = (board.side == WHITE) ? BLACK : WHITE;
+
+    while (count < 31) {
+        int attacker = leastValuableAttacker(board, attackers & board.occupancies[side], side);
+        if (attacker == NO_PIECE) {
+            break;
+        }
+        // A king may only recapture when the square is no longer defended
+        if ((attacker == WHITE_KING || attacker == BLACK_KING)
+            && (attackers & board.occupancies[side == WHITE ? BLACK : WHITE])) {
+            break;
+        }
+
+        count++;
+        gain[count] = getPieceValue(pieceOnSquare) - gain[count - 1];
+        pieceOnSquare = attacker;
+
+        occupancy ^= 1ULL << bitscanForward(attackers & board.bitboards[attacker]);
+        attackers |= (MoveGenerator::bishopAttacks(to, occupancy) & diagonal)
+                   | (MoveGenerator::rookAttacks(to, occupancy) & straight);
+        attackers &= occupancy;
+        side = (side == WHITE) ? BLACK : WHITE;
     }
 
-    // Piece values:
-    /*
-    Pawn = 100
-    Knight = 300
-    Bishop = 300
-    Rook = 500
-    Queen = 900
-    */
-    // If the total material is bellow this treshold, we are in endgame
-    return totalMaterial <= 1800; 
+    // Each side chooses between recapturing and standing pat
+    while (count > 0) {
+        gain[count - 1] = -std::max(-gain[count - 1], gain[count]);
+        count--;
+    }
+    return gain[0];
 }
 
+// True if the exchange started by the move wins at least threshold. Cheaper than see():
+// it stops as soon as the result is decided
+bool Evaluation::seeGe(const Board& board, const Move& move, int threshold) {
+    if (move.flags & FLAG_CASTLING) {
+        return 0 >= threshold; // The king cannot land on an attacked square, the rook is never en prise
+    }
 
+    int to = move.to_square;
+    U64 occupancy = board.occupancies[BOTH] ^ (1ULL << move.from_square);
+    if (move.flags & FLAG_EN_PASSANT) {
+        // The captured pawn stands next to the capturing pawn, on the rank it started from
+        occupancy ^= 1ULL << ((move.from_square & ~7) | (to & 7));
+    }
 
-int Evaluation::mirrorSquare(int square) {
-    int rank = square / 8;
-    int file = square % 8;
-    // Mirror the rank (0 becomes 7, 1 becomes 6, ..., 7 becomes 0)
-    int mirroredRank = 7 - rank;
-    return mirroredRank * 8 + file;
+    // Balance if the opponent does not recapture. A quiet move gains nothing, the swap
+    // sequence below still finds out whether the moved piece can be taken
+    int swap = (move.captured_piece == NO_PIECE ? 0 : getPieceValue(move.captured_piece)) - threshold;
+    if (swap < 0) {
+        return false;
+    }
+    // Balance if the opponent recaptures and we do not continue
+    int movedPiece = (move.promoted_piece != NO_PIECE) ? move.promoted_piece : move.piece;
+    swap = getPieceValue(movedPiece) - swap;
+    if (swap <= 0) {
+        return true;
+    }
+
+    U64 diagonal = board.bitboards[WHITE_BISHOP] | board.bitboards[BLACK_BISHOP]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+    U64 straight = board.bitboards[WHITE_ROOK] | board.bitboards[BLACK_ROOK]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+
+    U64 attackers = MoveGenerator::attackersTo(board, to, occupancy);
+    int side = board.side;
+    bool result = true;
+
+    while (true) {
+        side = (side == WHITE) ? BLACK : WHITE;
+        attackers &= occupancy;
+
+        U64 sideAttackers = attackers & board.occupancies[side];
+        if (!sideAttackers) {
+            break;
+        }
+        result = !result;
+
+        int attacker = leastValuableAttacker(board, sideAttackers, side);
+        if (attacker == WHITE_KING || attacker == BLACK_KING) {
+            // Capturing with the king only works if the opponent has no attackers left
+            return (attackers & ~board.occupancies[side]) ? !result : result;
+        }
+
+        swap = getPieceValue(attacker) - swap;
+        if (swap < static_cast<int>(result)) {
+            break;
+        }
+
+        occupancy ^= 1ULL << bitscanForward(sideAttackers & board.bitboards[attacker]);
+        attackers |= (MoveGenerator::bishopAttacks(to, occupancy) & diagonal)
+                   | (MoveGenerator::rookAttacks(to, occupancy) & straight);
+    }
+    return result;
 }
@@ -0,0 +1,66 @@
+#include "large_pages.h"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+void* LargePages::allocate(size_t bytes, PageKind& kind) {
+    kind = PAGES_NONE;
+    if (bytes == 0) {
+        return nullptr;
+    }
+    // Whole huge pages, so the end of the table does not share a page with anything else
+    size_t rounded = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+#if defined(__linux__)
+    void* memory = MAP_FAILED;
+#if defined(MAP_HUGETLB)
+    memory = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (memory != MAP_FAILED) {
+        kind = PAGES_HUGETLB;
+        return memory;
+    }
+#endif
+    memory = mmap(nullptr, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return nullptr;
+    }
+    kind = PAGES_NORMAL;
+#if defined(MADV_HUGEPAGE)
+    if (madvise(memory, rounded, MADV_HUGEPAGE) == 0) {
+        kind = PAGES_TRANSPARENT;
+    }
+#endif
+    return memory;
+#else
+    void* memory = std::aligned_alloc(HUGE_PAGE_SIZE, rounded);
+    if (memory != nullptr) {
+        std::memset(memory, 0, rounded);
+        kind = PAGES_NORMAL;
+    }
+    return memory;
+#endif
+}
+
+void LargePages::release(void* memory, size_t bytes, PageKind kind) {
+    if (memory == nullptr || kind == PAGES_NONE) {
+        return;
+    }
+#if defined(__linux__)
+    munmap(memory, (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE);
+#else
+    (void)bytes;
+    std::free(memory);
+#endif
+}
+
+const char* LargePages::describe(PageKind kind) {
+    switch (kind) {
+        case PAGES_HUGETLB:     return "2 MB huge pages";
+        case PAGES_TRANSPARENT: return "transparent huge pages";
+        case PAGES_NORMAL:      return "normal pages";
+        default:                return "no memory";
+    }
+}
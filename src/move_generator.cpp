@@ -9,43 +9,180 @@ void MoveGenerator::generateAllMoves(const Board& board, std::vector<Move>& move
     generateKingMoves(board, move_list);
 }
 
+// The legal move generators append to move_list: the pseudolegal moves are generated at its end
+// and filtered in place, so a list with enough capacity is filled without allocating
 void MoveGenerator::generateAllLegalMoves(const Board& board, std::vector<Move>& move_list) {
-    // Generate all pseudolegal moves
-    std::vector<Move> pseudolegal_moves;
-    generateAllMoves(board, pseudolegal_moves);
-    
-    // For each move, check if it's legal
-    for (const Move& move : pseudolegal_moves) {
-        Board board_copy = board;
+    size_t first = move_list.size();
+    generateAllMoves(board, move_list);
+    move_list.erase(std::remove_if(move_list.begin() + first, move_list.end(),
+                                   [&board](const Move& move) { return !isLegalMove(board, move); }),
+                    move_list.end());
+}
 
-        // Make the move on the copy, do not switch sides
-        board_copy.makeMove(move, false);
-        // std::cout << "Move " << squareToAlgebraic(move.from_square)<< " -> " << squareToAlgebraic(move.to_square) << "\n";
-        
-        // Check if the king is in check after the move
-        if (!isKingInCheck(board_copy, board.side)) {
-            // Move is legal, add to move_list
-            move_list.push_back(move);
+void MoveGenerator::generateAllCaptureMoves(const Board& board, std::vector<Move>& move_list) {
+    // Only the captures are checked for legality
+    size_t first = move_list.size();
+    generateAllMoves(board, move_list);
+    move_list.erase(std::remove_if(move_list.begin() + first, move_list.end(), [&board](const Move& move) {
+                        return move.captured_piece == NO_PIECE || !isLegalMove(board, move);
+                    }),
+                    move_list.end());
+}
+
+// Legal non-capturing moves that give check (used by the quiescence search)
+void MoveGenerator::generateQuietChecks(const Board& board, std::vector<Move>& move_list) {
+    size_t first = move_list.size();
+    generateAllMoves(board, move_list);
+    move_list.erase(std::remove_if(move_list.begin() + first, move_list.end(), [&board](const Move& move) {
+                        return move.captured_piece != NO_PIECE || move.promoted_piece != NO_PIECE
+                            || !givesCheck(board, move) || !isLegalMove(board, move);
+                    }),
+                    move_list.end());
+}
+
+// The move is one generateAllMoves would produce in this position, flags included. Used for moves
+// that come from elsewhere (the transposition table, killers, countermoves) without generating
+bool MoveGenerator::isPseudoLegal(const Board& board, const Move& move) {
+    int from = move.from_square;
+    int to = move.to_square;
+    if (from < 0 || from >= 64 || to < 0 || to >= 64 || move.piece < WHITE_PAWN || move.piece > BLACK_KING) {
+        return false;
+    }
+    int side = board.side;
+    int opponent_side = (side == WHITE) ? BLACK : WHITE;
+    if ((move.piece < BLACK_PAWN ? WHITE : BLACK) != side || !get_bit(board.bitboards[move.piece], from)
+        || get_bit(board.occupancies[side], to)) {
+        return false;
+    }
+
+    // The captured piece is the one on the target square, or the pawn taken en passant
+    int piece_type = move.piece % 6;
+    bool en_passant = move.flags & FLAG_EN_PASSANT;
+    int captured_piece = getPieceOnSquare(board, to, opponent_side);
+    if (en_passant) {
+        if (piece_type != WHITE_PAWN || to != board.en_passant || captured_piece != NO_PIECE) {
+            return false;
         }
-        // else {
-        //     // Debugging output
-        //     // std::cout << "Move " << squareToAlgebraic(move.from_square)
-        //     //           << " -> " << squareToAlgebraic(move.to_square)
-        //     //           << " is illegal; king is in check after this move.\n";
-        // }
+        captured_piece = (opponent_side == WHITE) ? WHITE_PAWN : BLACK_PAWN;
+    }
+    if (move.captured_piece != captured_piece || ((move.flags & FLAG_CAPTURE) != 0) != (captured_piece != NO_PIECE)) {
+        return false;
     }
-}
 
-void MoveGenerator::generateAllCaptureMoves(const Board& board, std::vector<Move>& move_list) {
-    
-    std::vector<Move> all_moves;
-    generateAllLegalMoves(board, all_moves);
-    
-    for (const Move& move : all_moves) {
-        if (move.captured_piece != NO_PIECE) {
-            move_list.push_back(move);
+    U64 occupancy = board.occupancies[BOTH];
+    U64 target = 1ULL << to;
+    if (piece_type == WHITE_PAWN) {
+        bool promotion = (to / 8) == ((side == WHITE) ? 7 : 0);
+        if (promotion != (move.promoted_piece != NO_PIECE) || promotion != ((move.flags & FLAG_PROMOTION) != 0)) {
+            return false;
         }
+        if (promotion && (move.promoted_piece % 6 < WHITE_KNIGHT || move.promoted_piece % 6 > WHITE_QUEEN
+                          || (move.promoted_piece < BLACK_PAWN ? WHITE : BLACK) != side)) {
+            return false;
+        }
+        if ((move.flags & FLAG_CASTLING) || (en_passant && promotion)) {
+            return false;
+        }
+        int push = (side == WHITE) ? NORTH : SOUTH;
+        bool double_push = move.flags & FLAG_PAWN_DOUBLE_PUSH;
+        if (captured_piece != NO_PIECE) {
+            return !double_push && (pawnAttacks(side, from) & target);
+        }
+        if (to == from + push) {
+            return !double_push && !(occupancy & target);
+        }
+        int start_rank = (side == WHITE) ? 1 : 6;
+        return double_push && to == from + 2 * push && from / 8 == start_rank
+            && !get_bit(occupancy, from + push) && !(occupancy & target);
+    }
+
+    if (move.promoted_piece != NO_PIECE || (move.flags & (FLAG_PROMOTION | FLAG_EN_PASSANT | FLAG_PAWN_DOUBLE_PUSH))) {
+        return false;
+    }
+    if (move.flags & FLAG_CASTLING) {
+        int king_square = (side == WHITE) ? E1 : E8;
+        if (piece_type != WHITE_KING || from != king_square || isKingInCheck(board, side)) {
+            return false;
+        }
+        if (to == king_square + 2) {
+            return canCastleKingSide(board, side) && isSafeToCastle(board, king_square, side, "king");
+        }
+        if (to == king_square - 2) {
+            return canCastleQueenSide(board, side) && isSafeToCastle(board, king_square, side, "queen");
+        }
+        return false;
+    }
+
+    switch (piece_type) {
+        case WHITE_KNIGHT: return knightAttacks(from) & target;
+        case WHITE_BISHOP: return bishopAttacks(from, occupancy) & target;
+        case WHITE_ROOK:   return rookAttacks(from, occupancy) & target;
+        case WHITE_QUEEN:  return queenAttacks(from, occupancy) & target;
+        default:           return kingAttacks(from) & target;
+    }
+}
+
+bool MoveGenerator::isLegalMove(const Board& board, const Move& move) {
+    Board board_copy = board;
+
+    // Make the move on the copy, do not switch sides
+    board_copy.makeMove(move, false);
+
+    // Check if the king is in check after the move
+    return !isKingInCheck(board_copy, board.side);
+}
+
+// Whether the move checks the opponent king, computed from attack bitboards without making it:
+// either the moved piece attacks the king from its new square, or one of our sliders does
+// through the squares the move vacated (discovered check, including the castling rook)
+bool MoveGenerator::givesCheck(const Board& board, const Move& move) {
+    int side = board.side;
+    int opponent_side = (side == WHITE) ? BLACK : WHITE;
+    U64 king = board.bitboards[(opponent_side == WHITE) ? WHITE_KING : BLACK_KING];
+    if (!king) {
+        return false;
+    }
+    int king_square = bitscanForward(king);
+
+    U64 occupancy = board.occupancies[BOTH];
+    occupancy &= ~(1ULL << move.from_square);
+    occupancy |= 1ULL << move.to_square;
+
+    int first = (side == WHITE) ? WHITE_PAWN : BLACK_PAWN;
+    U64 diagonal = board.bitboards[first + 2] | board.bitboards[first + 4];
+    U64 straight = board.bitboards[first + 3] | board.bitboards[first + 4];
+    diagonal &= ~(1ULL << move.from_square);
+    straight &= ~(1ULL << move.from_square);
+
+    if (move.flags & FLAG_EN_PASSANT) {
+        occupancy &= ~(1ULL << ((move.from_square & ~7) | (move.to_square & 7)));
+    }
+    if (move.flags & FLAG_CASTLING) {
+        int rook_from = (move.to_square > move.from_square) ? move.from_square + 3 : move.from_square - 4;
+        int rook_to = (move.to_square > move.from_square) ? move.from_square + 1 : move.from_square - 1;
+        occupancy &= ~(1ULL << rook_from);
+        occupancy |= 1ULL << rook_to;
+        straight &= ~(1ULL << rook_from);
+        straight |= 1ULL << rook_to;
+    }
+
+    // Direct check from the destination square
+    int piece = (move.promoted_piece != NO_PIECE) ? move.promoted_piece : move.piece;
+    U64 attacks = 0ULL;
+    switch (piece % 6) {
+        case WHITE_PAWN:   attacks = pawnAttacks(side, move.to_square); break;
+        case WHITE_KNIGHT: attacks = knightAttacks(move.to_square); break;
+        case WHITE_BISHOP: attacks = bishopAttacks(move.to_square, occupancy); break;
+        case WHITE_ROOK:   attacks = rookAttacks(move.to_square, occupancy); break;
+        case WHITE_QUEEN:  attacks = queenAttacks(move.to_square, occupancy); break;
+        default: break;
     }
+    if (attacks & king) {
+        return true;
+    }
+
+    // Discovered check by a slider that did not move
+    return (bishopAttacks(king_square, occupancy) & diagonal) || (rookAttacks(king_square, occupancy) & straight);
 }
 
 
@@ -415,19 +552,16 @@ void MoveGenerator::generateEnemyKingMoves(const Board& board, std::vector<Move>
         clear_bit(king, king_square);
     }
     
-    // For each move, check if it's legal
-    for (const Move& move : move_list) {
-        Board board_copy = board;
-
-        // Make the move on the copy, do not switch sides
-        board_copy.makeMove(move, false);
-        // std::cout << "Move " << squareToAlgebraic(move.from_square)<< " -> " << squareToAlgebraic(move.to_square) << "\n";
-        
-        if (isKingInCheck(board_copy, opponent_side)) {
-            // Move is legal, add to move_list
-            move_list.erase(std::find(move_list.begin(), move_list.end(), move));
-        }
-    }
+    // Remove the moves that leave the enemy king in check
+    // (erasing inside a range-for invalidates the iterator, so use erase-remove)
+    move_list.erase(std::remove_if(move_list.begin(), move_list.end(),
+        [&](const Move& move) {
+            Board board_copy = board;
+
+            // Make the move on the copy, do not switch sides
+            board_copy.makeMove(move, false);
+            return isKingInCheck(board_copy, opponent_side);
+        }), move_list.end());
 }
 
 
@@ -833,3 +967,115 @@ int MoveGenerator::getPieceOnSquare(const Board& board, int square, int opponent
     }
     return NO_PIECE;
 }
+
+
+//////////////////////
+// Attack bitboards //
+//////////////////////
+
+// Ray directions used by the attack tables: the first four move towards higher squares
+enum RayDirection { RAY_NORTH, RAY_EAST, RAY_NORTH_EAST, RAY_NORTH_WEST,
+                    RAY_SOUTH, RAY_WEST, RAY_SOUTH_WEST, RAY_SOUTH_EAST };
+
+// Precomputed attack sets for the leaper pieces and the empty-board rays of the sliders
+struct AttackTables {
+    U64 pawn[2][64];
+    U64 knight[64];
+    U64 king[64];
+    U64 rays[8][64];
+
+    AttackTables() {
+        const int ray_steps[8][2] = { // {file step, rank step}
+            {0, 1}, {1, 0}, {1, 1}, {-1, 1}, {0, -1}, {-1, 0}, {-1, -1}, {1, -1}
+        };
+        const int knight_steps[8][2] = {
+            {1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}
+        };
+
+        for (int square = 0; square < 64; ++square) {
+            int file = square % 8;
+            int rank = square / 8;
+
+            pawn[WHITE][square] = pawn[BLACK][square] = knight[square] = king[square] = 0ULL;
+            for (int df : {-1, 1}) {
+                if (file + df < 0 || file + df > 7) continue;
+                if (rank < 7) set_bit(pawn[WHITE][square], square + 8 + df);
+                if (rank > 0) set_bit(pawn[BLACK][square], square - 8 + df);
+            }
+
+            for (const auto& step : knight_steps) {
+                int f = file + step[0];
+                int r = rank + step[1];
+                if (f >= 0 && f < 8 && r >= 0 && r < 8) set_bit(knight[square], r * 8 + f);
+            }
+
+            for (int dir = 0; dir < 8; ++dir) {
+                int f = file + ray_steps[dir][0];
+                int r = rank + ray_steps[dir][1];
+                if (f >= 0 && f < 8 && r >= 0 && r < 8) set_bit(king[square], r * 8 + f);
+
+                rays[dir][square] = 0ULL;
+                while (f >= 0 && f < 8 && r >= 0 && r < 8) {
+                    set_bit(rays[dir][square], r * 8 + f);
+                    f += ray_steps[dir][0];
+                    r += ray_steps[dir][1];
+                }
+            }
+        }
+    }
+};
+
+static const AttackTables attack_tables;
+
+
+U64 MoveGenerator::pawnAttacks(int side, int square) {
+    return attack_tables.pawn[side][square];
+}
+
+U64 MoveGenerator::knightAttacks(int square) {
+    return attack_tables.knight[square];
+}
+
+U64 MoveGenerator::kingAttacks(int square) {
+    return attack_tables.king[square];
+}
+
+// Attacks along one ray, stopping at (and including) the first blocker
+U64 MoveGenerator::rayAttacks(int direction, int square, U64 occupancy) {
+    U64 attacks = attack_tables.rays[direction][square];
+    U64 blockers = attacks & occupancy;
+    if (blockers) {
+        int blocker = (direction < RAY_SOUTH) ? bitscanForward(blockers) : bitscanReverse(blockers);
+        attacks ^= attack_tables.rays[direction][blocker];
+    }
+    return attacks;
+}
+
+U64 MoveGenerator::bishopAttacks(int square, U64 occupancy) {
+    return rayAttacks(RAY_NORTH_EAST, square, occupancy) | rayAttacks(RAY_NORTH_WEST, square, occupancy)
+         | rayAttacks(RAY_SOUTH_EAST, square, occupancy) | rayAttacks(RAY_SOUTH_WEST, square, occupancy);
+}
+
+U64 MoveGenerator::rookAttacks(int square, U64 occupancy) {
+    return rayAttacks(RAY_NORTH, square, occupancy) | rayAttacks(RAY_SOUTH, square, occupancy)
+         | rayAttacks(RAY_EAST, square, occupancy) | rayAttacks(RAY_WEST, square, occupancy);
+}
+
+U64 MoveGenerator::queenAttacks(int square, U64 occupancy) {
+    return bishopAttacks(square, occupancy) | rookAttacks(square, occupancy);
+}
+
+U64 MoveGenerator::attackersTo(const Board& board, int square, U64 occupancy) {
+    U64 diagonal = board.bitboards[WHITE_BISHOP] | board.bitboards[BLACK_BISHOP]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+    U64 straight = board.bitboards[WHITE_ROOK] | board.bitboards[BLACK_ROOK]
+                 | board.bitboards[WHITE_QUEEN] | board.bitboards[BLACK_QUEEN];
+
+    // A white pawn attacks the square if a black pawn on the square would attack the pawn
+    return (pawnAttacks(BLACK, square) & board.bitboards[WHITE_PAWN])
+         | (pawnAttacks(WHITE, square) & board.bitboards[BLACK_PAWN])
+         | (knightAttacks(square) & (board.bitboards[WHITE_KNIGHT] | board.bitboards[BLACK_KNIGHT]))
+         | (kingAttacks(square) & (board.bitboards[WHITE_KING] | board.bitboards[BLACK_KING]))
+         | (bishopAttacks(square, occupancy) & diagonal)
+         | (rookAttacks(square, occupancy) & straight);
+}
@@ -0,0 +1,251 @@
+#include "move_picker.h"
+#include "search.h"
+#include <algorithm>
+
+MovePicker::MovePicker(SearchWorker& searchWorker, const Board& position, std::vector<Move>& move_list,
+                       uint16_t tt_packed_move, int searchPly)
+    : worker(searchWorker), board(position), moves(move_list), stage(MAIN_TT), ply(searchPly) {
+    setTTMove(tt_packed_move, true);
+
+    int stackPly = std::min(ply, Search::MAX_PLY);
+    const SearchStackEntry& entry = worker.search_stack[stackPly];
+    addRefutation(entry.killers[0]);
+    addRefutation(entry.killers[1]);
+    if (ply > 0) {
+        const Move& previous = worker.search_stack[stackPly - 1].current_move;
+        if (previous.piece != NO_PIECE) {
+            addRefutation(worker.counter_moves[previous.piece][previous.to_square]);
+        }
+    }
+}
+
+MovePicker::MovePicker(SearchWorker& searchWorker, const Board& position, std::vector<Move>& move_list,
+                       uint16_t tt_packed_move, bool in_check, bool with_quiet_checks)
+    : worker(searchWorker), board(position), moves(move_list), stage(in_check ? EVASION_TT : QSEARCH_TT),
+      quiet_checks(with_quiet_checks) {
+    setTTMove(tt_packed_move, in_check);
+}
+
+// The TT move comes from a position with the same key, so it is checked before it is searched.
+// In quiescence it must also be a move the node would generate: a capture, or a quiet check if asked for
+void MovePicker::setTTMove(uint16_t packed, bool any_move) {
+    Move move = TranspositionTable::unpackMove(board, packed);
+    if (move.from_square == -1 || !generator.isPseudoLegal(board, move) || !MoveGenerator::isLegalMove(board, move)) {
+        return;
+    }
+    bool tactical = isTactical(move);
+    bool quietCheck = quiet_checks && !tactical && move.promoted_piece == NO_PIECE && MoveGenerator::givesCheck(board, move);
+    if (any_move || tactical || quietCheck) {
+        tt_move = move;
+        tt_packed = packed;
+    }
+}
+
+void MovePicker::addRefutation(const Move& move) {
+    if (move.from_square == -1 || isTTMove(move) || isRefutation(move)) {
+        return;
+    }
+    refutations[refutation_count++] = move;
+}
+
+bool MovePicker::isTTMove(const Move& move) const {
+    return TranspositionTable::sameMove(move, tt_packed);
+}
+
+bool MovePicker::isRefutation(const Move& move) const {
+    for (int i = 0; i < refutation_count; ++i) {
+        if (move == refutations[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Most valuable victim first, then least valuable attacker (piece % 6 ranks pawn to king)
+void MovePicker::scoreCaptures() {
+    for (size_t i = current; i < moves.size(); ++i) {
+        const Move& move = moves[i];
+        scores[i] = Evaluation::getPieceValue(move.captured_piece) * 8 - (move.piece % 6)
+                  + worker.captureStatScore(move) / 16;
+        if (move.promoted_piece != NO_PIECE) {
+            scores[i] += Search::PROMOTION_SCORE;
+        }
+    }
+}
+
+void MovePicker::scoreQuiets() {
+    for (size_t i = current; i < moves.size(); ++i) {
+        const Move& move = moves[i];
+        scores[i] = worker.quietStatScore(board, move, ply);
+        if (move.promoted_piece != NO_PIECE) {
+            scores[i] += Search::PROMOTION_SCORE;
+        }
+    }
+}
+
+void MovePicker::scoreEvasions() {
+    for (size_t i = current; i < moves.size(); ++i) {
+        scores[i] = worker.scoreMove(moves[i], board, -1);
+    }
+}
+
+// Queen promotions go with the captures, so skipping the quiets (late move pruning) never drops them
+bool MovePicker::isTactical(const Move& move) {
+    return move.captured_piece != NO_PIECE || move.promoted_piece == WHITE_QUEEN || move.promoted_piece == BLACK_QUEEN;
+}
+
+// Pseudo-legal tactical moves or quiets: legality is only checked for the moves actually handed out
+void MovePicker::generate(bool tactical) {
+    size_t first = moves.size();
+    generator.generateAllMoves(board, moves);
+    moves.erase(std::remove_if(moves.begin() + first, moves.end(), [tactical](const Move& move) {
+                    return isTactical(move) != tactical;
+                }),
+                moves.end());
+}
+
+bool MovePicker::selectBest(Move& move) {
+    if (current >= moves.size()) {
+        return false;
+    }
+    size_t best = current;
+    for (size_t i = current + 1; i < moves.size(); ++i) {
+        if (scores[i] > scores[best]) {
+            best = i;
+        }
+    }
+    std::swap(moves[current], moves[best]);
+    std::swap(scores[current], scores[best]);
+    move = moves[current++];
+    return true;
+}
+
+bool MovePicker::next(Move& move) {
+    while (true) {
+        switch (stage) {
+            case MAIN_TT:
+            case QSEARCH_TT:
+            case EVASION_TT:
+                stage++;
+                if (tt_move.from_square != -1) {
+                    move = tt_move;
+                    return true;
+                }
+                break;
+
+            case CAPTURE_INIT:
+            case QCAPTURE_INIT:
+                moves.clear();
+                generate(true);
+                current = 0;
+                bad_captures_end = 0;
+                scoreCaptures();
+                stage++;
+                break;
+
+            case GOOD_CAPTURE:
+                while (selectBest(move)) {
+                    if (isTTMove(move) || !MoveGenerator::isLegalMove(board, move)) {
+                        continue;
+                    }
+                    // Captures that lose material are tried last, keep them in the part already handed out
+                    if (!Evaluation::seeGe(board, move, 0)) {
+                        moves[bad_captures_end++] = move;
+                        continue;
+                    }
+                    return true;
+                }
+                stage++;
+                break;
+
+            case REFUTATION:
+                while (!skip_quiets && refutation_index < refutation_count) {
+                    move = refutations[refutation_index++];
+                    if (!isTactical(move) && generator.isPseudoLegal(board, move)
+                        && MoveGenerator::isLegalMove(board, move)) {
+                        return true;
+                    }
+                }
+                stage++;
+                break;
+
+            case QUIET_INIT:
+                if (!skip_quiets) {
+                    moves.resize(bad_captures_end);
+                    current = bad_captures_end;
+                    generate(false);
+                    scoreQuiets();
+                }
+                stage++;
+                break;
+
+            case QUIET:
+                while (!skip_quiets && selectBest(move)) {
+                    if (!isTTMove(move) && !isRefutation(move) && MoveGenerator::isLegalMove(board, move)) {
+                        return true;
+                    }
+                }
+                current = 0;
+                stage++;
+                break;
+
+            case BAD_CAPTURE:
+                if (current < bad_captures_end) {
+                    move = moves[current++];
+                    return true;
+                }
+                stage = DONE;
+                break;
+
+            case QCAPTURE:
+                while (selectBest(move)) {
+                    if (!isTTMove(move) && MoveGenerator::isLegalMove(board, move)) {
+                        return true;
+                    }
+                }
+                stage++;
+                break;
+
+            case QCHECK_INIT:
+                if (!quiet_checks) {
+                    stage = DONE;
+                    break;
+                }
+                moves.clear();
+                generator.generateQuietChecks(board, moves);
+                current = 0;
+                stage++;
+                break;
+
+            case QCHECK:
+                while (current < moves.size()) {
+                    move = moves[current++];
+                    if (!isTTMove(move)) {
+                        return true;
+                    }
+                }
+                stage = DONE;
+                break;
+
+            case EVASION_INIT:
+                moves.clear();
+                generator.generateAllLegalMoves(board, moves);
+                current = 0;
+                scoreEvasions();
+                stage++;
+                break;
+
+            case EVASION:
+                while (selectBest(move)) {
+                    if (!isTTMove(move)) {
+                        return true;
+                    }
+                }
+                stage = DONE;
+                break;
+
+            default:
+                return false;
+        }
+    }
+}
@@ -0,0 +1,97 @@
+#include "numa.h"
+#include <fstream>
+#include <sstream>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const std::vector<std::vector<int>>& Numa::nodes() {
+    static const std::vector<std::vector<int>> topology = readTopology();
+    return topology;
+}
+
+std::vector<std::vector<int>> Numa::readTopology() {
+    std::vector<std::vector<int>> topology;
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string list;
+    if (!(online >> list)) {
+        return topology;
+    }
+    for (int node : parseList(list)) {
+        std::ifstream cpus("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+        std::string cpuList;
+        // Memory-only nodes have no CPUs to run on
+        if (cpus >> cpuList && !parseList(cpuList).empty()) {
+            topology.push_back(parseList(cpuList));
+        }
+    }
+    return topology;
+}
+
+std::vector<int> Numa::parseList(const std::string& list) {
+    std::vector<int> values;
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        size_t dash = range.find('-');
+        try {
+            int first = std::stoi(range.substr(0, dash));
+            int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+            for (int value = first; value <= last; ++value) {
+                values.push_back(value);
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+    return values;
+}
+
+bool Numa::bindToNode(int node) {
+    if (nodeCount() < 2 || node < 0 || node >= nodeCount()) {
+        return false;
+    }
+    CpuSet cpus;
+    for (int cpu : nodes()[node]) {
+        if (cpu < static_cast<int>(cpus.size())) {
+            cpus.set(cpu);
+        }
+    }
+    return setThreadAffinity(cpus);
+}
+
+bool Numa::threadAffinity(CpuSet& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (pthread_getaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+        return false;
+    }
+    cpus.reset();
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < static_cast<int>(cpus.size()); ++cpu) {
+        cpus[cpu] = CPU_ISSET(cpu, &set);
+    }
+    return true;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
+
+bool Numa::setThreadAffinity(const CpuSet& cpus) {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu = 0; cpu < CPU_SETSIZE && cpu < static_cast<int>(cpus.size()); ++cpu) {
+        if (cpus[cpu]) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpus;
+    return false;
+#endif
+}
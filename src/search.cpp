@@ -1,138 +1,945 @@
 #include "search.h"
+#include "move_picker.h"
+#include "numa.h"
+#include <thread>
 
-long long Search::nodes_searched = 0;
+bool Search::null_move_enabled = true;
+bool Search::lmr_enabled = true;
+bool Search::quiet_checks_enabled = true;
+bool Search::rfp_enabled = true;
+bool Search::futility_enabled = true;
+bool Search::lmp_enabled = true;
+bool Search::history_pruning_enabled = true;
+bool Search::razoring_enabled = true;
+bool Search::probcut_enabled = true;
+bool Search::singular_enabled = true;
+bool Search::check_extensions_enabled = true;
+bool Search::iir_enabled = true;
+PruningParameters Search::pruning;
+std::mutex Search::output_mutex;
+int Search::reductions[MAX_DEPTH][MAX_MOVES];
 
 
-Move Search::findBestMove(Board& board, int depth) {
-    nodes_searched = 0;
+// Precompute the late move reduction table: reductions grow with the log of both
+// the remaining depth and the number of moves already searched
+void Search::init() {
+    for (int depth = 0; depth < MAX_DEPTH; ++depth) {
+        for (int moveIndex = 0; moveIndex < MAX_MOVES; ++moveIndex) {
+            if (depth == 0 || moveIndex == 0) {
+                reductions[depth][moveIndex] = 0;
+                continue;
+            }
+            reductions[depth][moveIndex] = static_cast<int>(0.75 + std::log(depth) * std::log(moveIndex) / 2.25);
+        }
+    }
+}
+
+SearchWorker::SearchWorker(SearchPool& searchPool, int workerId) : pool(searchPool), id(workerId) {
+    root_moves.reserve(MoveGenerator::MAX_MOVES);
+    scored_moves.reserve(MoveGenerator::MAX_MOVES);
+    clear();
+}
+
+// Iterative deepening over the root moves. Only the main worker reports its iterations, the
+// helpers (lazy SMP) start at alternating depths so they do not all search the same iteration
+RootMove SearchWorker::search(const Board& board) {
+    root_board = board;
+    const SearchLimits& limits = pool.limits;
+    int depth = limits.depth > 0 ? limits.depth : MAX_PLY - 1;
+    counters.nodes.store(0, std::memory_order_relaxed);
+    counters.qnodes.store(0, std::memory_order_relaxed);
+    pawn_table.resetStatistics();
+    clearHeuristics();
     MoveGenerator moveGenerator;
-    std::vector<Move> move_list;
-    moveGenerator.generateAllLegalMoves(board, move_list);
-    orderMoves(move_list, board); // Move ordering for better pruning fo the search tree
-    Move bestMove;
-    int bestValue = INT_MIN;
-    int alpha = INT_MIN;
-    int beta = INT_MAX;
-    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Move>& move_list = search_stack[0].moves;
+    move_list.clear();
+    moveGenerator.generateAllLegalMoves(root_board, move_list);
+    orderMoves(move_list, root_board, 0); // Move ordering for better pruning fo the search tree
+
+    std::vector<RootMove>& rootMoves = root_moves;
+    rootMoves.clear();
     for (const Move& move : move_list) {
+        rootMoves.emplace_back(move, -Search::VALUE_INFINITE);
+    }
+    int lines = std::min<int>(std::max(pool.multi_pv, 1), rootMoves.size());
+    start_ms = SearchPool::nowMs();
+    last_info_ms = start_ms;
+    sel_depth = 0;
+    RootMove best = rootMoves.empty() ? RootMove(Move(), -Search::VALUE_INFINITE) : rootMoves[0];
+    int completedDepth = 0;
+    int reportedDepth = 0;
+
+    // Iterative deepening: each iteration fills the transposition table and
+    // puts the best move first, which makes the next, deeper iteration cheaper
+    for (int currentDepth = 1 + id % 2; currentDepth <= depth && !rootMoves.empty(); ++currentDepth) {
+        root_depth = currentDepth;
+        for (RootMove& rootMove : rootMoves) {
+            rootMove.previous_score = rootMove.score;
+        }
+
+        // MultiPV: line k searches the root moves the first k - 1 lines have not taken
+        for (int pvIndex = 0; pvIndex < lines && !pool.stop_requested; ++pvIndex) {
+            aspirationSearch(root_board, rootMoves, currentDepth, pvIndex);
+            // Keep the lines found so far ordered by score
+            sortRootMoves(rootMoves.begin(), rootMoves.begin() + pvIndex + 1);
+        }
+        // An interrupted iteration is incomplete, the previous one stands
+        if (pool.stop_requested) {
+            break;
+        }
+        best = rootMoves[0];
+        completedDepth = currentDepth;
+
+        // Quick iterations are not all reported, the one at the depth limit always is
+        long long now = SearchPool::nowMs();
+        if (id == 0 && !pool.pondering && (currentDepth == depth || now - last_info_ms >= Search::INFO_INTERVAL_MS)) {
+            for (int pvIndex = 0; pvIndex < lines; ++pvIndex) {
+                printInfo(rootMoves[pvIndex], currentDepth, pvIndex + 1, now);
+            }
+            reportedDepth = currentDepth;
+        }
+        // With a budget from the clock, an iteration started past half of it would rarely finish in time
+        if (id == 0 && !pool.pondering && pool.time_from_clock && now - pool.start_time_ms >= pool.time_budget_ms / 2) {
+            break;
+        }
+    }
+    // The protocol allows no result while pondering or in an infinite search, even at the depth limit
+    if (id == 0) {
+        while ((pool.pondering || limits.infinite) && !pool.stop_requested) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    // Stopped before the last completed iteration was reported
+    if (id == 0 && !pool.pondering && completedDepth > reportedDepth) {
+        printInfo(best, completedDepth, 1, SearchPool::nowMs());
+    }
+    return best;
+}
+
+
+SearchPool::SearchPool(int threads) {
+    setThreads(threads);
+}
+
+void SearchPool::setThreads(int threads) {
+    threads = std::max(1, std::min(threads, MAX_THREADS));
+    workers.resize(std::min<size_t>(workers.size(), threads));
+    while (static_cast<int>(workers.size()) < threads) {
+        int workerId = static_cast<int>(workers.size());
+        std::unique_ptr<SearchWorker> worker;
+        // Constructed on its node: the constructor clears the tables, which places their pages there
+        std::thread([this, workerId, &worker]() {
+            bindThread(workerId);
+            worker = std::make_unique<SearchWorker>(*this, workerId);
+        }).join();
+        workers.push_back(std::move(worker));
+    }
+}
+
+void SearchPool::setNumaBinding(bool enabled) {
+    numa_binding = enabled;
+    int count = threads();
+    workers.clear();
+    setThreads(count);
+}
+
+void SearchPool::bindThread(int workerId) const {
+    if (numa_binding && Numa::nodeCount() > 1) {
+        Numa::bindToNode(workerId % Numa::nodeCount());
+    }
+}
+
+void SearchPool::clear() {
+    tt.clear();
+    for (auto& worker : workers) {
+        worker->clear();
+    }
+}
+
+long long SearchPool::nodes() const {
+    long long total = 0;
+    for (const auto& worker : workers) {
+        total += worker->nodes();
+    }
+    return total;
+}
+
+long long SearchPool::qnodes() const {
+    long long total = 0;
+    for (const auto& worker : workers) {
+        total += worker->qnodes();
+    }
+    return total;
+}
+
+long long SearchPool::pawnHashProbes() const {
+    long long total = 0;
+    for (const auto& worker : workers) {
+        total += worker->pawnTable().probes();
+    }
+    return total;
+}
+
+long long SearchPool::pawnHashHits() const {
+    long long total = 0;
+    for (const auto& worker : workers) {
+        total += worker->pawnTable().hits();
+    }
+    return total;
+}
+
+Move SearchPool::findBestMove(const Board& board, int depth) {
+    SearchLimits depthLimit;
+    depthLimit.depth = depth;
+    return findBestMove(board, depthLimit);
+}
+
+Move SearchPool::findBestMove(const Board& board, const SearchLimits& searchLimits) {
+    limits = searchLimits;
+    stop_requested = false;
+    pondering = limits.ponder;
+    time_budget_ms = timeBudget(limits, board.side);
+    time_from_clock = limits.move_time_ms <= 0 && time_budget_ms > 0;
+    start_time_ms = nowMs();
+    tt.newSearch();
+    running = true;
+    started++;
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // The helpers search until the main worker is done, their results only reach it through the table
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < workers.size(); ++i) {
+        helpers.emplace_back([this, &board, i]() {
+            bindThread(static_cast<int>(i));
+            workers[i]->search(board);
+        });
+    }
+    // The calling thread runs the main worker, on the node of its tables, and gets its own CPUs back after
+    Numa::CpuSet callerCpus;
+    bool restoreAffinity = numa_binding && Numa::nodeCount() > 1 && Numa::threadAffinity(callerCpus);
+    bindThread(0);
+    RootMove best = workers[0]->search(board);
+    stop_requested = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    if (restoreAffinity) {
+        Numa::setThreadAffinity(callerCpus);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end - start;
+    if (!pondering && report_summary) {
+        std::cout << "Time taken for the search: " << duration.count() << " seconds\n";
+        std::cout << "Nodes searched: " << nodes() + qnodes()
+                  << " (quiescence nodes: " << qnodes() << ")" << std::endl;
+    }
+
+    ponder_move = best.pv_length > 1 ? best.pv[1] : Move();
+    running = false;
+    return best.move;
+}
+
+void SearchPool::stop() {
+    stop_requested = true;
+}
+
+void SearchPool::ponderHit() {
+    start_time_ms = nowMs(); // The time limit counts from now, the search keeps its tree and TT
+    pondering = false;
+}
+
+// movetime is used as given. From the clock: an even share of the remaining time over the moves to go,
+// plus most of the increment, never closer to the flag than MOVE_OVERHEAD_MS
+long long SearchPool::timeBudget(const SearchLimits& searchLimits, int side) {
+    if (searchLimits.move_time_ms > 0) {
+        return searchLimits.move_time_ms;
+    }
+    long long left = searchLimits.time_ms[side];
+    if (left <= 0) {
+        return 0;
+    }
+    int movesToGo = searchLimits.moves_to_go > 0 ? searchLimits.moves_to_go : Search::MOVES_TO_GO_ESTIMATE;
+    long long budget = left / movesToGo + searchLimits.increment_ms[side] * 3 / 4;
+    return std::max(1LL, std::min(budget, left - Search::MOVE_OVERHEAD_MS));
+}
+
+long long SearchPool::nowMs() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Stop the search once its node or time limit is used up (not while pondering, and never in the first
+// iteration). Only the main worker checks, against the nodes of all workers
+void SearchWorker::checkLimits() {
+    if (id != 0 || pool.pondering || root_depth <= 1) {
+        return;
+    }
+    const SearchLimits& limits = pool.limits;
+    if (limits.nodes > 0 && pool.nodes() + pool.qnodes() >= limits.nodes) {
+        pool.stop_requested = true;
+    }
+    if ((nodes() & 1023) != 0) {
+        return;
+    }
+    long long now = SearchPool::nowMs();
+    if (pool.time_budget_ms > 0 && now - pool.start_time_ms >= pool.time_budget_ms) {
+        pool.stop_requested = true;
+    }
+    if (now - last_info_ms >= Search::PROGRESS_INTERVAL_MS) {
+        printProgress(now);
+    }
+}
+
+// Stable sort by score, from best to worst. An insertion sort, the root move lists are short and
+// std::stable_sort would allocate a buffer
+void SearchWorker::sortRootMoves(std::vector<RootMove>::iterator first, std::vector<RootMove>::iterator last) {
+    for (auto it = first; it != last; ++it) {
+        for (auto current = it; current != first && (current - 1)->score < current->score; --current) {
+            std::iter_swap(current - 1, current);
+        }
+    }
+}
+
+// Search the line pvIndex in a window around its previous score, widening it on a fail low or high
+void SearchWorker::aspirationSearch(Board& board, std::vector<RootMove>& rootMoves, int depth, int pvIndex) {
+    int previous = rootMoves[pvIndex].previous_score;
+    int delta = Search::ASPIRATION_WINDOW;
+    int alpha = -Search::VALUE_INFINITE;
+    int beta = Search::VALUE_INFINITE;
+    if (depth >= Search::ASPIRATION_MIN_DEPTH && std::abs(previous) < Search::VALUE_MATE_IN_MAX_PLY) {
+        alpha = std::max(previous - delta, -Search::VALUE_INFINITE);
+        beta = std::min(previous + delta, Search::VALUE_INFINITE);
+    }
+
+    while (true) {
+        int score = rootSearch(board, rootMoves, depth, alpha, beta, pvIndex);
+        if (pool.stop_requested) {
+            return;
+        }
+        // Moves after the line keep their order from the previous iteration unless they scored better
+        sortRootMoves(rootMoves.begin() + pvIndex, rootMoves.end());
+
+        if (score <= alpha) {
+            beta = (alpha + beta) / 2;
+            alpha = std::max(score - delta, -Search::VALUE_INFINITE);
+        } else if (score >= beta) {
+            beta = std::min(score + delta, Search::VALUE_INFINITE);
+        } else {
+            return;
+        }
+        delta += delta / 2;
+    }
+}
+
+// Search the root moves from pvIndex on (the ones before belong to earlier MultiPV lines).
+// The first move gets the full window, the others a null window and a re-search if they beat alpha
+int SearchWorker::rootSearch(Board& board, std::vector<RootMove>& rootMoves, int depth, int alpha, int beta, int pvIndex) {
+    int bestValue = -Search::VALUE_INFINITE;
+
+    for (size_t i = pvIndex; i < rootMoves.size(); ++i) {
+        RootMove& rootMove = rootMoves[i];
+        const Move& move = rootMove.move;
         Board tempBoard = board;
         tempBoard.makeMove(move);
+        prefetch(tempBoard);
+        search_stack[0].current_move = move;
+        search_stack[0].continuation_history = &continuation_history[move.piece][move.to_square];
+
+        int score;
+        if (i == static_cast<size_t>(pvIndex)) {
+            score = -negamax(tempBoard, depth - 1, -beta, -alpha, 1, true);
+        } else {
+            score = -negamax(tempBoard, depth - 1, -alpha - 1, -alpha, 1, true);
+            if (score > alpha && score < beta) {
+                score = -negamax(tempBoard, depth - 1, -beta, -alpha, 1, true);
+            }
+        }
+        if (pool.stop_requested) {
+            break;
+        }
 
-        int score = -negamax(tempBoard, depth - 1, -beta, -alpha);
+        if (i == static_cast<size_t>(pvIndex) || score > alpha) {
+            rootMove.score = score;
+            const SearchStackEntry& child = search_stack[1];
+            int length = std::min(child.pv_length, MAX_PLY - 1);
+            rootMove.pv[0] = move;
+            std::copy(child.pv, child.pv + length, rootMove.pv + 1);
+            rootMove.pv_length = length + 1;
+        } else {
+            rootMove.score = -Search::VALUE_INFINITE; // Only known to be worse than the line's best move
+        }
 
         if (score > bestValue) {
             bestValue = score;
-            bestMove = move;
-        }
-        if (bestValue > alpha) {
-            alpha = bestValue;
+            if (score > alpha) {
+                alpha = score;
+                if (alpha >= beta) {
+                    break;
+                }
+            }
         }
     }
-    auto end = std::chrono::high_resolution_clock::now();   
-    std::chrono::duration<double> duration = end - start;
-    std::cout << "Time taken for the search: " << duration.count() << " seconds\n";
+    return bestValue;
+}
 
-    std::cout << "Leaf nodes evaluated: " << nodes_searched << std::endl;
+void SearchWorker::printInfo(const RootMove& rootMove, int depth, int multiPvLine, long long now) {
+    std::lock_guard<std::mutex> lock(Search::output_mutex);
+    std::cout << "info depth " << depth << " seldepth " << sel_depth << " multipv " << multiPvLine << " score ";
+    if (rootMove.score >= Search::VALUE_MATE_IN_MAX_PLY) {
+        std::cout << "mate " << (Search::VALUE_MATE - rootMove.score + 1) / 2;
+    } else if (rootMove.score <= Search::VALUE_MATED_IN_MAX_PLY) {
+        std::cout << "mate " << -(Search::VALUE_MATE + rootMove.score) / 2;
+    } else {
+        std::cout << "cp " << rootMove.score;
+    }
+    printStatistics(now);
+    std::cout << " pv";
+    for (int i = 0; i < rootMove.pv_length; ++i) {
+        std::cout << " " << toUCI2(rootMove.pv[i]);
+    }
+    std::cout << std::endl;
+    last_info_ms = now;
+}
 
-    return bestMove;
+// Still searching the iteration at root_depth
+void SearchWorker::printProgress(long long now) {
+    std::lock_guard<std::mutex> lock(Search::output_mutex);
+    std::cout << "info depth " << root_depth << " seldepth " << sel_depth;
+    printStatistics(now);
+    std::cout << std::endl;
+    last_info_ms = now;
+}
+
+void SearchWorker::printStatistics(long long now) {
+    long long nodes = pool.nodes() + pool.qnodes();
+    long long elapsed = now - start_ms;
+    std::cout << " nodes " << nodes << " nps " << nodes * 1000 / std::max(elapsed, 1LL)
+              << " hashfull " << pool.tt.hashfull() << " time " << elapsed;
+}
+
+// Principal variation of the node: the move just searched followed by the child's variation
+void SearchWorker::updatePv(int ply, const Move& move) {
+    SearchStackEntry& entry = search_stack[ply];
+    const SearchStackEntry& child = search_stack[ply + 1];
+    entry.pv[0] = move;
+    int length = std::min(child.pv_length, MAX_PLY - ply - 1);
+    std::copy(child.pv, child.pv + length, entry.pv + 1);
+    entry.pv_length = length + 1;
 }
 
 
-int Search::negamax(Board& board, int depth, int alpha, int beta) {
-    if (depth == 0) {
-        return quiescence(board, alpha, beta);
+// Mate scores are stored in the transposition table relative to the stored position instead of
+// the root, so an entry reached at a different ply still reports the right distance to mate
+int SearchWorker::valueToTT(int score, int ply) {
+    if (score >= Search::VALUE_MATE_IN_MAX_PLY) {
+        return score + ply;
     }
+    if (score <= Search::VALUE_MATED_IN_MAX_PLY) {
+        return score - ply;
+    }
+    return score;
+}
 
-    MoveGenerator moveGenerator;
-    std::vector<Move> move_list;
-    moveGenerator.generateAllLegalMoves(board, move_list);
-    orderMoves(move_list, board); 
+int SearchWorker::valueFromTT(int score, int ply) {
+    if (score >= Search::VALUE_MATE_IN_MAX_PLY) {
+        return score - ply;
+    }
+    if (score <= Search::VALUE_MATED_IN_MAX_PLY) {
+        return score + ply;
+    }
+    return score;
+}
 
-    if (move_list.empty()) {
-        if (moveGenerator.isKingInCheck(board, board.side)) {
-            return -999999 + depth; // Checkmate
+void SearchWorker::prefetch(const Board& child) const {
+    pool.tt.prefetch(child.hash_key);
+    ::prefetch(&eval_cache[child.hash_key & (Search::EVAL_CACHE_SIZE - 1)]);
+    pawn_table.prefetch(child.pawn_key);
+}
+
+// Static evaluation through the per-thread cache, so nodes visited again (and the
+// nodes the transposition table no longer holds) do not call evaluatePosition
+int SearchWorker::staticEval(const Board& board) {
+    if (board.DRAW == 1) {
+        return 0; // Depends on the game history, not only on the position
+    }
+    EvalCacheEntry& cached = eval_cache[board.hash_key & (Search::EVAL_CACHE_SIZE - 1)];
+    if (cached.key != board.hash_key) {
+        cached.key = board.hash_key;
+        cached.eval = Evaluation::evaluatePosition(board, &pawn_table);
+    }
+    return cached.eval;
+}
+
+int SearchWorker::negamax(Board& board, int depth, int alpha, int beta, int ply, bool allow_null) {
+    search_stack[std::min(ply, MAX_PLY)].pv_length = 0;
+    if (board.isRepetition() || board.isFiftyMoveRule()) {
+        return Search::VALUE_DRAW;
+    }
+    if (ply >= MAX_PLY) {
+        return staticEval(board); // The search stack ends here
+    }
+    // Upcoming repetition: a reversible move repeats an earlier position, so at least a draw is available
+    if (alpha < Search::VALUE_DRAW && board.hasUpcomingRepetition(ply)) {
+        alpha = Search::VALUE_DRAW;
+        if (alpha >= beta) {
+            return alpha;
+        }
+    }
+
+    if (depth <= 0) {
+        return quiescence(board, alpha, beta, ply, 0);
+    }
+
+    increment(counters.nodes);
+    sel_depth = std::max(sel_depth, ply);
+    checkLimits();
+
+    // Mate distance pruning: even mating on the next move cannot beat a shorter mate found elsewhere
+    alpha = std::max(alpha, Search::matedIn(ply));
+    beta = std::min(beta, Search::mateIn(ply + 1));
+    if (alpha >= beta) {
+        return alpha;
+    }
+    int alphaOrig = alpha;
+
+    SearchStackEntry& entry = search_stack[std::min(ply, MAX_PLY)];
+    uint16_t excluded_move = entry.excluded_move;
+    entry.double_extensions = ply > 0 ? search_stack[std::min(ply - 1, MAX_PLY)].double_extensions : 0;
+    entry.check_extensions = ply > 0 ? search_stack[std::min(ply - 1, MAX_PLY)].check_extensions : 0;
+    U64 position_key = excluded_move ? board.hash_key ^ (Search::EXCLUSION_KEY * excluded_move) : board.hash_key;
+
+    // Transposition table: a result from an earlier search that is at least as deep can be reused
+    TTEntry tt_entry;
+    bool tt_hit = pool.tt.probe(position_key, tt_entry);
+    if (tt_hit) {
+        tt_entry.score = valueFromTT(tt_entry.score, ply);
+    }
+    uint16_t tt_move = tt_hit ? tt_entry.move : 0;
+    bool pv_node = beta - alpha > 1;
+    // Not at PV nodes: a cutoff there would end the principal variation at this node
+    if (!pv_node && tt_hit && tt_entry.depth >= depth) {
+        int tt_score = tt_entry.score;
+        if (tt_entry.bound() == TT_EXACT
+            || (tt_entry.bound() == TT_LOWER && tt_score >= beta)
+            || (tt_entry.bound() == TT_UPPER && tt_score <= alpha)) {
+            return tt_score;
+        }
+    }
+
+    bool in_check = MoveGenerator::isKingInCheck(board, board.side);
+
+    // Static evaluation of the node, compared with the one two plies ago to know if our position is improving
+    entry.in_check = in_check;
+    if (in_check) {
+        entry.static_eval = 0;
+    } else {
+        entry.static_eval = tt_hit ? tt_entry.static_eval : staticEval(board);
+    }
+
+    bool improving = false;
+    if (!in_check) {
+        if (ply < 2 || search_stack[std::min(ply - 2, MAX_PLY)].in_check) {
+            improving = true;
         } else {
-            return 0; // Stalemate
+            improving = entry.static_eval > search_stack[std::min(ply - 2, MAX_PLY)].static_eval;
         }
     }
 
-    int bestValue = -999999;
+    // Reverse futility pruning: at shallow depth a static eval far above beta is trusted to hold
+    if (Search::rfp_enabled && !pv_node && !excluded_move && !in_check && depth <= Search::pruning.rfp_max_depth
+        && std::abs(beta) < Search::VALUE_MATE_IN_MAX_PLY
+        && entry.static_eval - Search::pruning.rfp_margin * (depth - improving) >= beta) {
+        return entry.static_eval;
+    }
+
+    // Razoring: with a static eval this far below alpha, only tactics can save the node, so let quiescence decide
+    if (Search::razoring_enabled && !pv_node && !excluded_move && !in_check && depth <= Search::pruning.razor_max_depth
+        && alpha < Search::VALUE_MATE_IN_MAX_PLY
+        && entry.static_eval + Search::pruning.razor_base + Search::pruning.razor_margin * depth < alpha) {
+        int score = quiescence(board, alpha - 1, alpha, ply, 0);
+        if (score < alpha) {
+            return score;
+        }
+    }
+
+    // Null-move pruning: give the opponent a free move, if a reduced search still fails high
+    // the position is good enough to cut. Skipped when in check, right after another null move
+    // and in pawn-only endings, where zugzwang makes passing a bad assumption
+    if (Search::null_move_enabled && allow_null && !excluded_move && !in_check && depth >= Search::NULL_MOVE_MIN_DEPTH
+        && board.hasNonPawnMaterial(board.side)
+        && std::abs(beta) < Search::VALUE_MATE_IN_MAX_PLY) {
+
+        int reduction = 2 + depth / 4;
+        int nullDepth = std::max(0, depth - 1 - reduction);
+
+        entry.current_move = Move();
+        entry.continuation_history = nullptr;
+        board.makeNullMove();
+        prefetch(board);
+        int nullScore = -negamax(board, nullDepth, -beta, -beta + 1, ply + 1, false);
+        board.unmakeNullMove();
+
+        if (nullScore >= beta) {
+            if (depth < Search::NULL_MOVE_VERIFICATION_DEPTH) {
+                return beta;
+            }
+            // At high depth verify the cutoff with a reduced search of our own moves
+            int verifyScore = negamax(board, nullDepth, beta - 1, beta, ply, false);
+            if (verifyScore >= beta) {
+                return beta;
+            }
+        }
+    }
+
+    // Internal iterative reductions: without a TT move from a search almost as deep the move ordering
+    // is poor, so search this node one ply shallower; the next iteration will find it with a TT move
+    if (Search::iir_enabled && !excluded_move && depth >= Search::IIR_MIN_DEPTH && (!tt_move || tt_entry.depth < depth - 4)) {
+        depth--;
+    }
+
+    // ProbCut: if a good capture beats beta by a margin in a reduced search, the full search very likely fails high too
+    if (Search::probcut_enabled && !pv_node && !excluded_move && !in_check && depth >= Search::pruning.probcut_min_depth) {
+        int score;
+        if (probCut(board, depth, beta, ply, tt_hit ? &tt_entry : nullptr, score)) {
+            return score;
+        }
+    }
+
+    int bestValue = -Search::VALUE_INFINITE;
+    Move bestMove;
+    int moveIndex = 0;
+    Move* quietsTried = entry.quiets_tried;
+    int quietCount = 0;
+    Move* capturesTried = entry.captures_tried;
+    int captureCount = 0;
+    // Singular extension: if every move but the TT move fails low against a bound somewhat below the
+    // TT score in a reduced search, the TT move is the only good one and is searched deeper
+    int singularExtension = 0;
+    if (Search::singular_enabled && tt_move && !excluded_move && depth >= Search::SINGULAR_MIN_DEPTH && ply < 2 * root_depth
+        && (tt_entry.bound() == TT_LOWER || tt_entry.bound() == TT_EXACT) && tt_entry.depth >= depth - 3
+        && std::abs(tt_entry.score) < Search::VALUE_MATE_IN_MAX_PLY) {
+
+        int singularBeta = tt_entry.score - Search::SINGULAR_MARGIN * depth;
+        entry.excluded_move = tt_move;
+        int singularScore = negamax(board, (depth - 1) / 2, singularBeta - 1, singularBeta, ply, false);
+        entry.excluded_move = 0;
+
+        if (singularScore < singularBeta) {
+            singularExtension = 1;
+            if (!pv_node && singularScore < singularBeta - Search::DOUBLE_EXTENSION_MARGIN
+                && entry.double_extensions < Search::MAX_DOUBLE_EXTENSIONS) {
+                singularExtension = 2; // Counted for the TT move's children only, in the move loop
+            }
+        } else if (singularBeta >= beta) {
+            // Multi-cut: another move also beats beta, so several moves fail high and the node is cut
+            return singularBeta;
+        }
+    }
+
+    int lmpCount = (Search::pruning.lmp_base + depth * depth) / (2 - improving);
+    int futilityValue = entry.static_eval + Search::pruning.futility_base + Search::pruning.futility_margin * depth;
+
+    // Moves are generated as the picker reaches their stage, the singular search nested at this ply has its own list
+    MovePicker picker(*this, board, excluded_move ? entry.singular_moves : entry.moves, tt_move, ply);
+    int legalMoves = 0;
+    Move move;
+    while (picker.next(move)) {
+        legalMoves++;
+        if (excluded_move && TranspositionTable::sameMove(move, excluded_move)) {
+            continue;
+        }
+        bool quiet = move.captured_piece == NO_PIECE && move.promoted_piece == NO_PIECE;
+        bool gives_check = MoveGenerator::givesCheck(board, move);
+        int extension = 0;
+        bool checkExtension = false;
+        if (singularExtension && TranspositionTable::sameMove(move, tt_move)) {
+            extension = singularExtension;
+        } else if (Search::check_extensions_enabled && gives_check && ply < 2 * root_depth
+                   && entry.check_extensions < Search::MAX_CHECK_EXTENSIONS && Evaluation::seeGe(board, move, 0)) {
+            // Check extension: do not drop into quiescence right after a check that does not lose material
+            extension = 1;
+            checkExtension = true;
+        }
+        int newDepth = depth - 1 + extension;
+
+        // Shallow depth pruning of quiet moves, once a move that is not getting mated has been found
+        if (quiet && !in_check && moveIndex > 0 && bestValue > Search::VALUE_MATED_IN_MAX_PLY) {
+            // Late move pruning: with this many quiets tried, the rest are unlikely to matter
+            if (Search::lmp_enabled && !pv_node && depth <= Search::pruning.lmp_max_depth && quietCount >= lmpCount) {
+                picker.skipQuiets();
+                continue;
+            }
+            // History pruning: at low depth, skip quiets that keep failing after the moves that led here
+            if (Search::history_pruning_enabled && depth <= Search::pruning.history_max_depth && !gives_check
+                && continuationScore(move, ply) < -Search::pruning.history_margin * depth) {
+                continue;
+            }
+            // Futility pruning: a quiet move will not make up for a static eval this far below alpha
+            if (Search::futility_enabled && depth <= Search::pruning.futility_max_depth && futilityValue <= alpha && !gives_check) {
+                continue;
+            }
+        }
 
-    for (const Move& move : move_list) {
         Board tempBoard = board;
         tempBoard.makeMove(move);
+        prefetch(tempBoard);
+        entry.current_move = move;
+        entry.continuation_history = &continuation_history[move.piece][move.to_square];
+        if (checkExtension) {
+            entry.check_extensions++; // Counted for the children of this move only
+        }
+        if (extension == 2) {
+            entry.double_extensions++;
+        }
 
-        int score = -negamax(tempBoard, depth - 1, -beta, -alpha);
+        // Late move reductions: quiet moves late in the ordering are unlikely to be best,
+        // so search them at reduced depth first and only re-search if they beat alpha
+        int reduction = 0;
+        if (Search::lmr_enabled && depth >= Search::LMR_MIN_DEPTH && moveIndex >= Search::LMR_MIN_MOVE_INDEX && quiet && !in_check) {
+            reduction = Search::reductions[std::min(depth, Search::MAX_DEPTH - 1)][std::min(moveIndex, Search::MAX_MOVES - 1)];
+
+            if (pv_node) {
+                reduction--;
+            }
+            if (gives_check) {
+                reduction--; // Checking moves are tactically relevant
+            }
+            if (!improving) {
+                reduction++;
+            }
+            // Moves with a good history are reduced less, moves that keep failing are reduced more
+            reduction -= quietStatScore(board, move, ply) / Search::LMR_HISTORY_DIVISOR;
+            reduction = std::max(0, std::min(reduction, depth - 2));
+        }
+
+        int score;
+        if (reduction > 0) {
+            score = -negamax(tempBoard, newDepth - reduction, -alpha - 1, -alpha, ply + 1, true);
+            if (score > alpha) {
+                // The reduced search failed high, verify it at full depth
+                score = -negamax(tempBoard, newDepth, -beta, -alpha, ply + 1, true);
+            }
+        } else {
+            score = -negamax(tempBoard, newDepth, -beta, -alpha, ply + 1, true);
+        }
+        moveIndex++;
+        if (pool.stop_requested) {
+            return 0; // The result is discarded by the root
+        }
+        if (checkExtension) {
+            entry.check_extensions--;
+        }
+        if (extension == 2) {
+            entry.double_extensions--;
+        }
 
         if (score > bestValue) {
             bestValue = score;
         }
         if (bestValue > alpha) {
             alpha = bestValue;
+            bestMove = move;
+            if (pv_node && ply < MAX_PLY) {
+                updatePv(ply, move);
+            }
         }
         if (alpha >= beta) {
+            updateStatistics(board, move, quietsTried, quietCount, capturesTried, captureCount, depth, ply);
             break; // Beta cutoff
         }
+        if (quiet && quietCount < MAX_TRIED_MOVES) {
+            quietsTried[quietCount++] = move;
+        } else if (move.captured_piece != NO_PIECE && captureCount < MAX_TRIED_MOVES) {
+            capturesTried[captureCount++] = move;
+        }
+    }
+
+    if (legalMoves == 0) {
+        return in_check ? Search::matedIn(ply) : Search::VALUE_DRAW; // Checkmate or stalemate
     }
+    // Only the excluded move was legal
+    if (excluded_move && bestValue == -Search::VALUE_INFINITE) {
+        return alpha;
+    }
+
+    TTBound bound = (bestValue >= beta) ? TT_LOWER : (bestValue > alphaOrig ? TT_EXACT : TT_UPPER);
+    pool.tt.store(position_key, valueToTT(bestValue, ply), entry.static_eval, depth, bound, TranspositionTable::packMove(bestMove));
     return bestValue;
 }
 
 
-int Search::quiescence(Board& board, int alpha, int beta) {
+bool SearchWorker::probCut(Board& board, int depth, int beta, int ply, const TTEntry* tt_entry, int& score) {
+    int probcutBeta = beta + Search::pruning.probcut_margin;
+    if (std::abs(beta) >= Search::VALUE_MATE_IN_MAX_PLY) {
+        return false;
+    }
+    // The table already knows that a search almost as deep stays below the raised beta
+    if (tt_entry != nullptr && tt_entry->depth >= depth - Search::PROBCUT_REDUCTION + 1
+        && tt_entry->bound() != TT_LOWER && tt_entry->score < probcutBeta) {
+        return false;
+    }
 
-    nodes_searched++;
+    SearchStackEntry& entry = search_stack[std::min(ply, MAX_PLY)];
+    MovePicker picker(*this, board, entry.moves, 0, false, false);
+    Move move;
+    while (picker.next(move)) {
+        // Only captures that already win enough material on the exchange
+        if (!Evaluation::seeGe(board, move, probcutBeta - entry.static_eval)) {
+            continue;
+        }
 
-    int stand_pat = Evaluation::evaluatePosition(board);
-    if (stand_pat >= beta) {
-        return beta;
+        Board tempBoard = board;
+        tempBoard.makeMove(move);
+        prefetch(tempBoard);
+        entry.current_move = move;
+        entry.continuation_history = &continuation_history[move.piece][move.to_square];
+
+        // A quiescence search first, the reduced search only confirms the captures that hold up
+        score = -quiescence(tempBoard, -probcutBeta, -probcutBeta + 1, ply + 1, 0);
+        if (score >= probcutBeta) {
+            score = -negamax(tempBoard, depth - Search::PROBCUT_REDUCTION, -probcutBeta, -probcutBeta + 1, ply + 1, true);
+        }
+        if (pool.stop_requested) {
+            return false; // An aborted search returns 0, which must not be stored as a cutoff
+        }
+        if (score >= probcutBeta) {
+            pool.tt.store(board.hash_key, valueToTT(score, ply), entry.static_eval, depth - Search::PROBCUT_REDUCTION + 1, TT_LOWER,
+                     TranspositionTable::packMove(move));
+            return true;
+        }
     }
-    if (alpha < stand_pat) {
-        alpha = stand_pat;
+    return false;
+}
+
+
+// Quiescence search: only captures (plus quiet checks at its first ply) until the position is quiet.
+// When in check there is no stand pat and every evasion is searched
+int SearchWorker::quiescence(Board& board, int alpha, int beta, int ply, int qply) {
+    search_stack[std::min(ply, MAX_PLY)].pv_length = 0;
+    if (ply >= MAX_PLY) {
+        return staticEval(board); // The search stack ends here
     }
 
-    MoveGenerator moveGenerator;
-    std::vector<Move> capture_moves;
-    moveGenerator.generateAllCaptureMoves(board, capture_moves);
-    orderMoves(capture_moves, board); 
+    increment(counters.qnodes);
+    sel_depth = std::max(sel_depth, ply);
+    int alphaOrig = alpha;
+
+    TTEntry tt_entry;
+    bool tt_hit = pool.tt.probe(board.hash_key, tt_entry);
+    if (tt_hit) {
+        tt_entry.score = valueFromTT(tt_entry.score, ply);
+    }
+    uint16_t tt_move = tt_hit ? tt_entry.move : 0;
+    if (tt_hit) {
+        int tt_score = tt_entry.score;
+        if (tt_entry.bound() == TT_EXACT
+            || (tt_entry.bound() == TT_LOWER && tt_score >= beta)
+            || (tt_entry.bound() == TT_UPPER && tt_score <= alpha)) {
+            return tt_score;
+        }
+    }
 
+    bool in_check = MoveGenerator::isKingInCheck(board, board.side);
+    int stand_pat = 0;
+    int bestValue;
+
+    if (in_check) {
+        bestValue = Search::matedIn(ply); // Mated unless an evasion is found
+    } else {
+        stand_pat = tt_hit ? tt_entry.static_eval : staticEval(board);
+        bestValue = stand_pat;
+        if (stand_pat >= beta) {
+            if (!tt_hit) {
+                pool.tt.store(board.hash_key, stand_pat, stand_pat, 0, TT_LOWER, 0);
+            }
+            return stand_pat;
+        }
+        if (alpha < stand_pat) {
+            alpha = stand_pat;
+        }
+    }
+
+    // Captures (quiet checks at the first ply), or every evasion when in check
+    MovePicker picker(*this, board, search_stack[ply].moves, tt_move, in_check, qply == 0 && Search::quiet_checks_enabled);
+    Move bestMove;
+    Move move;
+    while (picker.next(move)) {
+        if (!in_check && move.captured_piece != NO_PIECE) {
+            // Delta pruning: even winning the captured piece with a safety margin does not reach alpha
+            if (move.promoted_piece == NO_PIECE
+                && stand_pat + Evaluation::getPieceValue(move.captured_piece) + Search::DELTA_MARGIN <= alpha) {
+                continue;
+            }
+            // Captures that lose material cannot raise alpha over the stand pat, skip them
+            if (!Evaluation::seeGe(board, move, 0)) {
+                continue;
+            }
+        }
 
-    for (const Move& move : capture_moves) {
         Board tempBoard = board;
         tempBoard.makeMove(move);
+        prefetch(tempBoard);
 
-        int score = -quiescence(tempBoard, -beta, -alpha);
+        int score = -quiescence(tempBoard, -beta, -alpha, ply + 1, qply + 1);
 
-        if (score >= beta) {
-            return beta;
-        }
-        if (score > alpha) {
-            alpha = score;
+        if (score > bestValue) {
+            bestValue = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                if (alpha >= beta) {
+                    break;
+                }
+            }
         }
     }
-    return alpha;
+
+    TTBound bound = (bestValue >= beta) ? TT_LOWER : (bestValue > alphaOrig ? TT_EXACT : TT_UPPER);
+    pool.tt.store(board.hash_key, valueToTT(bestValue, ply), stand_pat, 0, bound, TranspositionTable::packMove(bestMove));
+    return bestValue;
 }
 
-int Search::scoreMove(const Move& move, const Board& board) {
+int SearchWorker::scoreMove(const Move& move, const Board& board, int ply) {
     int score = 0;
     if (move.captured_piece != NO_PIECE) {
+        // Most valuable victim first, then least valuable attacker (piece % 6 ranks pawn to king)
         int victimValue = Evaluation::getPieceValue(move.captured_piece);
-        int attackerValue = Evaluation::getPieceValue(move.piece);
-        score += 1000 + (victimValue - attackerValue);
+        int mvvLva = victimValue * 8 - (move.piece % 6) + captureStatScore(move) / 16;
+
+        // Captures that lose material in the exchange are tried after the quiet moves
+        bool winning = Evaluation::seeGe(board, move, 0);
+        score += (winning ? Search::CAPTURE_SCORE : Search::BAD_CAPTURE_SCORE) + mvvLva;
     }
     if (move.promoted_piece != NO_PIECE) {
-        score += 800;
+        score += Search::PROMOTION_SCORE;
     }
-    if (MoveGenerator::isKingInCheck(board, board.side)) {
-        score += 500;
+    if (move.captured_piece != NO_PIECE || move.promoted_piece != NO_PIECE || ply < 0) {
+        return score;
     }
-    // For the future: can add more heruistics to improve move scoring
-    return score;
+
+    // Quiet moves: killers, then the countermove, then by history
+    int stackPly = std::min(ply, MAX_PLY);
+    if (move == search_stack[stackPly].killers[0]) {
+        return Search::KILLER_1_SCORE;
+    }
+    if (move == search_stack[stackPly].killers[1]) {
+        return Search::KILLER_2_SCORE;
+    }
+    if (ply > 0) {
+        const Move& previous = search_stack[stackPly - 1].current_move;
+        if (previous.piece != NO_PIECE && move == counter_moves[previous.piece][previous.to_square]) {
+            return Search::COUNTER_MOVE_SCORE;
+        }
+    }
+    return quietStatScore(board, move, ply);
 }
 
-void Search::orderMoves(std::vector<Move>& move_list, Board& board) {
-    std::vector<std::pair<int, Move>> scoredMoves;
+void SearchWorker::orderMoves(std::vector<Move>& move_list, Board& board, int ply) {
+    std::vector<std::pair<int, Move>>& scoredMoves = scored_moves;
+    scoredMoves.clear();
     for (const Move& move : move_list) {
-        int score = scoreMove(move, board);
+        int score = scoreMove(move, board, ply);
         scoredMoves.emplace_back(score, move);
     }
     std::sort(scoredMoves.begin(), scoredMoves.end(),
@@ -142,3 +949,131 @@ void Search::orderMoves(std::vector<Move>& move_list, Board& board) {
         move_list.push_back(pair.second);
     }
 }
+
+
+////////////////////////////////////
+// Quiet move ordering heuristics //
+////////////////////////////////////
+
+// This worker's histories, countermoves and caches start empty; the pool clears the shared TT itself
+void SearchWorker::clear() {
+    std::fill(&history[0][0][0], &history[0][0][0] + 2 * 64 * 64, 0);
+    std::fill(&continuation_history[0][0][0][0], &continuation_history[0][0][0][0] + 12 * 64 * 12 * 64, 0);
+    std::fill(&capture_history[0][0][0], &capture_history[0][0][0] + 12 * 64 * 12, 0);
+    std::fill(&counter_moves[0][0], &counter_moves[0][0] + 12 * 64, Move());
+    std::fill(eval_cache, eval_cache + Search::EVAL_CACHE_SIZE, EvalCacheEntry());
+    pawn_table.clear();
+}
+
+// Before each search: killers are per search, while the history tables and countermoves carry over
+// (aged by halving)
+void SearchWorker::clearHeuristics() {
+    for (int ply = 0; ply <= MAX_PLY; ++ply) {
+        search_stack[ply].killers[0] = Move();
+        search_stack[ply].killers[1] = Move();
+    }
+    for (int side = 0; side < 2; ++side) {
+        for (int from = 0; from < 64; ++from) {
+            for (int to = 0; to < 64; ++to) {
+                history[side][from][to] /= 2;
+            }
+        }
+    }
+    for (int piece = 0; piece < 12; ++piece) {
+        for (int to = 0; to < 64; ++to) {
+            for (int i = 0; i < 12 * 64; ++i) {
+                int16_t& entry = (&continuation_history[piece][to][0][0])[i];
+                entry /= 2;
+            }
+            for (int captured = 0; captured < 12; ++captured) {
+                capture_history[piece][to][captured] /= 2;
+            }
+        }
+    }
+}
+
+// Continuation history sub-table selected by the move played pliesBack plies above this node
+PieceToHistory* SearchWorker::previousContinuation(int ply, int pliesBack) {
+    if (ply < pliesBack) {
+        return nullptr;
+    }
+    return search_stack[std::min(ply - pliesBack, MAX_PLY)].continuation_history;
+}
+
+// Combined quiet move statistics: butterfly history plus the continuation histories of the
+// moves 1, 2 and 4 plies back
+int SearchWorker::quietStatScore(const Board& board, const Move& move, int ply) {
+    return history[board.side][move.from_square][move.to_square] + continuationScore(move, ply);
+}
+
+// Continuation histories of the moves 1, 2 and 4 plies back
+int SearchWorker::continuationScore(const Move& move, int ply) {
+    int score = 0;
+    for (int pliesBack : {1, 2, 4}) {
+        PieceToHistory* continuation = previousContinuation(ply, pliesBack);
+        if (continuation != nullptr) {
+            score += (*continuation)[move.piece][move.to_square];
+        }
+    }
+    return score;
+}
+
+int SearchWorker::captureStatScore(const Move& move) {
+    return capture_history[move.piece][move.to_square][move.captured_piece];
+}
+
+// Gravity update: the bonus shrinks as the entry approaches the limit, so scores saturate
+// smoothly at +-MAX_HISTORY and recent results weigh more than old ones
+void SearchWorker::applyGravity(int16_t& entry, int bonus) {
+    entry += bonus - entry * std::abs(bonus) / Search::MAX_HISTORY;
+}
+
+void SearchWorker::updateHistory(int side, const Move& move, int bonus) {
+    applyGravity(history[side][move.from_square][move.to_square], bonus);
+}
+
+void SearchWorker::updateContinuationHistory(const Move& move, int bonus, int ply) {
+    for (int pliesBack : {1, 2, 4}) {
+        PieceToHistory* continuation = previousContinuation(ply, pliesBack);
+        if (continuation != nullptr) {
+            applyGravity((*continuation)[move.piece][move.to_square], bonus);
+        }
+    }
+}
+
+void SearchWorker::updateStatistics(const Board& board, const Move& bestMove, const Move* quietsTried, int quietCount,
+                              const Move* capturesTried, int captureCount, int depth, int ply) {
+    int stackPly = std::min(ply, MAX_PLY);
+    int bonus = std::min(depth * depth, Search::MAX_HISTORY_BONUS);
+
+    if (bestMove.captured_piece == NO_PIECE && bestMove.promoted_piece == NO_PIECE) {
+        Move* killers = search_stack[stackPly].killers;
+        if (!(killers[0] == bestMove)) {
+            killers[1] = killers[0];
+            killers[0] = bestMove;
+        }
+
+        if (ply > 0) {
+            const Move& previous = search_stack[stackPly - 1].current_move;
+            if (previous.piece != NO_PIECE) {
+                counter_moves[previous.piece][previous.to_square] = bestMove;
+            }
+        }
+
+        // Reward the move that caused the cutoff and penalize the quiets searched before it
+        updateHistory(board.side, bestMove, bonus);
+        updateContinuationHistory(bestMove, bonus, ply);
+        for (int i = 0; i < quietCount; ++i) {
+            updateHistory(board.side, quietsTried[i], -bonus);
+            updateContinuationHistory(quietsTried[i], -bonus, ply);
+        }
+    } else if (bestMove.captured_piece != NO_PIECE) {
+        applyGravity(capture_history[bestMove.piece][bestMove.to_square][bestMove.captured_piece], bonus);
+    }
+
+    // Captures that were tried first and did not cut are penalized in either case
+    for (int i = 0; i < captureCount; ++i) {
+        const Move& capture = capturesTried[i];
+        applyGravity(capture_history[capture.piece][capture.to_square][capture.captured_piece], -bonus);
+    }
+}
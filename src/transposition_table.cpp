@@ -0,0 +1,184 @@
+#include "transposition_table.h"
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+TranspositionTable::TranspositionTable() {
+    if (!resize(DEFAULT_SIZE_MB)) {
+        throw std::bad_alloc(); // No previous table to fall back on
+    }
+}
+
+TranspositionTable::~TranspositionTable() {
+    LargePages::release(clusters, cluster_count * sizeof(TTCluster), page_kind);
+}
+
+// Use the largest power of two number of clusters that fits the requested size,
+// so a key is mapped to its cluster with a mask
+bool TranspositionTable::resize(size_t megabytes) {
+    size_t count = 1;
+    while (count * 2 * sizeof(TTCluster) <= megabytes * 1024 * 1024) {
+        count *= 2;
+    }
+    // The new table is allocated before the old one is freed, so a failure leaves a working table
+    PageKind kind = PAGES_NONE;
+    TTCluster* table = static_cast<TTCluster*>(LargePages::allocate(count * sizeof(TTCluster), kind));
+    if (table == nullptr) {
+        return false;
+    }
+    LargePages::release(clusters, cluster_count * sizeof(TTCluster), page_kind);
+    clusters = table;
+    page_kind = kind;
+    cluster_count = count;
+    index_mask = count - 1;
+    // The memory is already zero, clearing it touches every page now instead of during the first searches
+    clear();
+    return true;
+}
+
+void TranspositionTable::clear() {
+    size_t bytes = cluster_count * sizeof(TTCluster);
+    int threads = static_cast<int>(std::min<size_t>(std::thread::hardware_concurrency(), bytes / MIN_CLEAR_CHUNK));
+    threads = std::max(1, std::min(threads, MAX_CLEAR_THREADS));
+    size_t chunk = (cluster_count + threads - 1) / threads;
+    auto clearRange = [this, chunk](int index) {
+        size_t first = std::min(cluster_count, index * chunk);
+        size_t last = std::min(cluster_count, first + chunk);
+        std::fill(clusters + first, clusters + last, TTCluster());
+    };
+
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < threads; ++i) {
+        helpers.emplace_back(clearRange, i);
+    }
+    clearRange(0);
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+    generation = 0;
+}
+
+// Entries from older searches become the first candidates for replacement
+void TranspositionTable::newSearch() {
+    generation = (generation + 1) & 63;
+}
+
+bool TranspositionTable::probe(U64 key, TTEntry& entry) const {
+    const TTCluster& cluster = clusterFor(key);
+    uint32_t check = entryKey(key);
+    for (const TTEntry& candidate : cluster.entries) {
+        if (candidate.key == check && candidate.bound() != TT_NONE) {
+            entry = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(U64 key, int score, int static_eval, int depth, TTBound bound, uint16_t move) {
+    TTCluster& cluster = clusterFor(key);
+    uint32_t check = entryKey(key);
+
+    // Reuse the entry of the same position, otherwise replace the least valuable one:
+    // shallow entries and entries left over from previous searches go first
+    TTEntry* replace = &cluster.entries[0];
+    for (TTEntry& candidate : cluster.entries) {
+        if (candidate.key == check || candidate.bound() == TT_NONE) {
+            replace = &candidate;
+            break;
+        }
+        int candidateAge = (generation - candidate.generation()) & 63;
+        int replaceAge = (generation - replace->generation()) & 63;
+        if (candidate.depth - 8 * candidateAge < replace->depth - 8 * replaceAge) {
+            replace = &candidate;
+        }
+    }
+
+    if (replace->key == check && replace->bound() != TT_NONE) {
+        // A much shallower bound does not replace a deeper result for the same position
+        if (bound != TT_EXACT && depth + 2 < replace->depth && replace->generation() == generation) {
+            return;
+        }
+        // Keep the previous best move if the new search of this position did not find one
+        if (move == 0) {
+            move = replace->move;
+        }
+    }
+
+    replace->key = check;
+    replace->score = static_cast<int16_t>(score);
+    replace->static_eval = static_cast<int16_t>(static_eval);
+    replace->move = move;
+    replace->depth = static_cast<int8_t>(depth);
+    replace->generation_bound = static_cast<uint8_t>((generation << 2) | bound);
+}
+
+int TranspositionTable::hashfull() const {
+    size_t sample = std::min<size_t>(1000, cluster_count);
+    int used = 0;
+    for (size_t i = 0; i < sample; ++i) {
+        for (const TTEntry& entry : clusters[i].entries) {
+            if (entry.bound() != TT_NONE && entry.generation() == generation) {
+                used++;
+            }
+        }
+    }
+    return used * 1000 / static_cast<int>(sample * TTCluster::SIZE);
+}
+
+uint16_t TranspositionTable::packMove(const Move& move) {
+    if (move.from_square < 0) {
+        return 0;
+    }
+    int promotion = (move.promoted_piece == NO_PIECE) ? 0 : move.promoted_piece % 6;
+    return static_cast<uint16_t>(move.from_square | (move.to_square << 6) | (promotion << 12));
+}
+
+bool TranspositionTable::sameMove(const Move& move, uint16_t packed) {
+    return packed != 0 && packMove(move) == packed;
+}
+
+Move TranspositionTable::unpackMove(const Board& board, uint16_t packed) {
+    if (packed == 0) {
+        return Move();
+    }
+    int from = packed & 63;
+    int to = (packed >> 6) & 63;
+    int promotion = packed >> 12;
+
+    int piece = NO_PIECE;
+    int captured = NO_PIECE;
+    for (int p = WHITE_PAWN; p <= BLACK_KING; ++p) {
+        if (get_bit(board.bitboards[p], from)) {
+            piece = p;
+        }
+        if (get_bit(board.bitboards[p], to)) {
+            captured = p;
+        }
+    }
+    if (piece == NO_PIECE) {
+        return Move();
+    }
+
+    uint8_t flags = FLAG_NONE;
+    bool pawn = piece % 6 == WHITE_PAWN;
+    if (pawn && to == board.en_passant && captured == NO_PIECE && from % 8 != to % 8) {
+        captured = (piece == WHITE_PAWN) ? BLACK_PAWN : WHITE_PAWN;
+        flags |= FLAG_EN_PASSANT;
+    }
+    if (captured != NO_PIECE) {
+        flags |= FLAG_CAPTURE;
+    }
+    int promoted = NO_PIECE;
+    if (promotion != 0) {
+        promoted = promotion + (piece < BLACK_PAWN ? 0 : 6);
+        flags |= FLAG_PROMOTION;
+    }
+    if (pawn && std::abs(to - from) == 16) {
+        flags |= FLAG_PAWN_DOUBLE_PUSH;
+    }
+    if (piece % 6 == WHITE_KING && std::abs(to - from) == 2) {
+        flags |= FLAG_CASTLING;
+    }
+    return Move(from, to, piece, captured, promoted, flags);
+}
@@ -0,0 +1,227 @@
+#include "uci.h"
+#include <charconv>
+#include <thread>
+
+void Uci::loop() {
+    SearchPool pool;
+    pool.report_summary = false;
+    CommandQueue queue;
+    std::thread engine(engineLoop, std::ref(pool), std::ref(queue));
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        std::istringstream command(line);
+        std::string token;
+        command >> token;
+
+        if (token == "stop") {
+            pool.stop();
+        } else if (token == "ponderhit") {
+            pool.ponderHit();
+        } else if (token == "isready" && pool.searching()) {
+            send("readyok"); // The engine thread is busy with the search, answer for it
+        } else if (token == "quit") {
+            break;
+        } else if (token == "go") {
+            // Wait for the search to start, so a stop or ponderhit read next cannot arrive before it
+            long long searches = pool.searchesStarted();
+            queue.push(line);
+            while (pool.searchesStarted() == searches) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        } else if (!token.empty()) {
+            queue.push(line);
+        }
+    }
+
+    pool.stop();
+    queue.push("quit");
+    engine.join();
+}
+
+void Uci::CommandQueue::push(const std::string& command) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        commands.push_back(command);
+    }
+    available.notify_one();
+}
+
+std::string Uci::CommandQueue::pop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [this]() { return !commands.empty(); });
+    std::string command = commands.front();
+    commands.pop_front();
+    return command;
+}
+
+// Runs the queued commands in order; a go blocks this thread (not the main one) until its bestmove
+void Uci::engineLoop(SearchPool& pool, CommandQueue& queue) {
+    Board board;
+    board.loadFEN(START_FEN);
+
+    while (true) {
+        std::istringstream command(queue.pop());
+        std::string token;
+        command >> token;
+
+        if (token == "uci") {
+            std::ostringstream options;
+            options << "id name Athena\n";
+            options << "id author Antonio Jotta\n";
+            options << "option name Hash type spin default " << TranspositionTable::DEFAULT_SIZE_MB
+                    << " min 1 max " << MAX_HASH_MB << "\n";
+            options << "option name Threads type spin default 1 min 1 max " << SearchPool::MAX_THREADS << "\n";
+            options << "option name MultiPV type spin default 1 min 1 max " << MAX_MULTI_PV << "\n";
+            options << "option name Ponder type check default false\n";
+            options << "option name NUMA Bind type check default true\n";
+            options << "option name Clear Hash type button\n";
+            options << "uciok";
+            send(options.str());
+            sendHashInfo(pool);
+        } else if (token == "isready") {
+            send("readyok");
+        } else if (token == "ucinewgame") {
+            pool.clear(); // TT, histories and eval cache start empty, as on a fresh run
+        } else if (token == "setoption") {
+            setOption(pool, command);
+        } else if (token == "position") {
+            position(board, command);
+        } else if (token == "go") {
+            go(pool, board, command);
+        } else if (token == "quit") {
+            break;
+        }
+    }
+}
+
+// position [startpos | fen <fen>] [moves <move>...]
+void Uci::position(Board& board, std::istringstream& command) {
+    std::string token;
+    command >> token;
+
+    if (token == "startpos") {
+        board.loadFEN(START_FEN);
+        command >> token; // "moves", if any
+    } else if (token == "fen") {
+        std::string fen;
+        while (command >> token && token != "moves") {
+            fen += token + " ";
+        }
+        board.loadFEN(fen);
+    }
+
+    while (command >> token) {
+        Move move = parseMove(board, token);
+        if (move.from_square == -1) {
+            send("info string illegal move " + token);
+            break;
+        }
+        board.makeMove(move);
+    }
+}
+
+// go [depth <d>] [nodes <n>] [movetime <ms>] [wtime <ms>] [btime <ms>] [winc <ms>] [binc <ms>]
+// [movestogo <n>] [ponder] [infinite]. Without limits the search runs until stop
+void Uci::go(SearchPool& pool, Board& board, std::istringstream& command) {
+    SearchLimits limits;
+    std::string token;
+    while (command >> token) {
+        if (token == "depth") {
+            command >> limits.depth;
+        } else if (token == "nodes") {
+            command >> limits.nodes;
+        } else if (token == "movetime") {
+            command >> limits.move_time_ms;
+        } else if (token == "wtime") {
+            command >> limits.time_ms[WHITE];
+        } else if (token == "btime") {
+            command >> limits.time_ms[BLACK];
+        } else if (token == "winc") {
+            command >> limits.increment_ms[WHITE];
+        } else if (token == "binc") {
+            command >> limits.increment_ms[BLACK];
+        } else if (token == "movestogo") {
+            command >> limits.moves_to_go;
+        } else if (token == "ponder") {
+            limits.ponder = true;
+        } else if (token == "infinite") {
+            limits.infinite = true;
+        }
+    }
+
+    Move bestMove = pool.findBestMove(board, limits);
+    send("info nodes " + std::to_string(pool.nodes() + pool.qnodes()));
+    std::string result = "bestmove " + (bestMove.from_square == -1 ? std::string("0000") : toUCI2(bestMove));
+    if (pool.ponder_move.from_square != -1) {
+        result += " ponder " + toUCI2(pool.ponder_move);
+    }
+    send(result);
+}
+
+// setoption name <name> [value <value>]
+void Uci::setOption(SearchPool& pool, std::istringstream& command) {
+    std::string token, name, value;
+    command >> token; // "name"
+    while (command >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    command >> value;
+
+    int number = 0;
+    bool spin = name == "Hash" || name == "Threads" || name == "MultiPV";
+    if (spin && !parseSpin(value, 1, name == "Hash" ? MAX_HASH_MB : name == "Threads" ? SearchPool::MAX_THREADS : MAX_MULTI_PV, number)) {
+        send("info string invalid value '" + value + "' for " + name);
+    } else if (name == "Hash") {
+        if (!pool.tt.resize(number)) {
+            send("info string cannot allocate " + std::to_string(number) + " MB for the hash, keeping the current table");
+        }
+        sendHashInfo(pool);
+    } else if (name == "Threads") {
+        pool.setThreads(number);
+    } else if (name == "MultiPV") {
+        pool.multi_pv = number;
+    } else if (name == "NUMA Bind") {
+        pool.setNumaBinding(value == "true");
+    } else if (name == "Clear Hash") {
+        pool.tt.clear();
+    } else if (name != "Ponder") { // Pondering is driven by go ponder, nothing to set
+        send("info string unknown option " + name);
+    }
+}
+
+bool Uci::parseSpin(const std::string& value, int min, int max, int& result) {
+    long long number = 0;
+    const char* end = value.data() + value.size();
+    auto parsed = std::from_chars(value.data(), end, number);
+    if (parsed.ec == std::errc::result_out_of_range) {
+        number = (!value.empty() && value[0] == '-') ? min : max;
+    } else if (parsed.ec != std::errc() || parsed.ptr != end) {
+        return false;
+    }
+    result = static_cast<int>(std::max<long long>(min, std::min<long long>(number, max)));
+    return true;
+}
+
+// The legal move with this UCI notation, or a move with from_square -1 if there is none
+Move Uci::parseMove(const Board& board, const std::string& moveStr) {
+    MoveGenerator moveGenerator;
+    std::vector<Move> move_list;
+    moveGenerator.generateAllLegalMoves(board, move_list);
+    for (const Move& move : move_list) {
+        if (toUCI2(move) == moveStr) {
+            return move;
+        }
+    }
+    return Move();
+}
+
+// How the transposition table was allocated: huge pages make a difference on large tables
+void Uci::sendHashInfo(const SearchPool& pool) {
+    send("info string hash " + std::to_string(pool.tt.sizeMb()) + " MB on " + LargePages::describe(pool.tt.pageKind()));
+}
+
+void Uci::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(Search::output_mutex);
+    std::cout << line << std::endl;
+}
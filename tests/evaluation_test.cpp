@@ -8,6 +8,7 @@
 
 // Function to display the board and its evaluation
 void displayBoardAndEvaluation(Board& board) {
+    board.computePsqt(); // The tests set the bitboards by hand
     board.printBoard();
     int score = Evaluation::evaluatePosition(board);
     std::cout << "Board Evaluation: " << score << "\n\n";
@@ -122,6 +123,12 @@ void testPawnEvaluations(){
     testIsolatedPawns();
 }
 
+void testStaticExchange();
+void testActivity();
+void testIncrementalPsqt();
+void testPawnHashTable();
+void testPawnPenalties();
+
 int main() {
 
     // testEvaluationOnlyKings();
@@ -164,6 +171,11 @@ int main() {
 
     // Add more test cases as needed...
     // testPawnEvaluations();
+    testStaticExchange();
+    testActivity();
+    testIncrementalPsqt();
+    testPawnHashTable();
+    testPawnPenalties();
 
     std::cout << "All FEN evaluation tests completed.\n";
     return 0;
@@ -306,3 +318,213 @@ void testIsolatedPawns(){
     displayBoardAndEvaluation(board);
 
 }
+
+
+// Static exchange evaluation of captures and quiet moves, including x-ray recaptures
+void testStaticExchange() {
+    Board board;
+
+    // Queen takes an undefended pawn
+    board.loadFEN("4k3/8/8/3p4/8/8/8/3QK3 w - - 0 1");
+    Move queenTakesPawn(D1, D5, WHITE_QUEEN, BLACK_PAWN, NO_PIECE, FLAG_CAPTURE);
+    assert(Evaluation::see(board, queenTakesPawn) == 100);
+    assert(Evaluation::seeGe(board, queenTakesPawn, 0));
+
+    // Queen takes a pawn defended by a pawn
+    board.loadFEN("4k3/8/4p3/3p4/8/8/8/3QK3 w - - 0 1");
+    assert(Evaluation::see(board, queenTakesPawn) == -800);
+    assert(!Evaluation::seeGe(board, queenTakesPawn, 0));
+
+    // Doubled rooks: the rook behind joins the exchange once the first one has captured
+    board.loadFEN("4k3/3r4/8/3p4/8/8/3R4/3RK3 w - - 0 1");
+    Move rookTakesPawn(D2, D5, WHITE_ROOK, BLACK_PAWN, NO_PIECE, FLAG_CAPTURE);
+    assert(Evaluation::see(board, rookTakesPawn) == 100);
+    assert(Evaluation::seeGe(board, rookTakesPawn, 100));
+    assert(!Evaluation::seeGe(board, rookTakesPawn, 101));
+
+    // Without the second rook the exchange loses the rook for a pawn
+    board.loadFEN("4k3/3r4/8/3p4/8/8/3R4/4K3 w - - 0 1");
+    assert(Evaluation::see(board, rookTakesPawn) == -400);
+    assert(!Evaluation::seeGe(board, rookTakesPawn, 0));
+
+    // Pawn takes a defended knight: the recapture does not undo the gain
+    board.loadFEN("4k3/8/4p3/3n4/4P3/8/8/4K3 w - - 0 1");
+    Move pawnTakesKnight(E4, D5, WHITE_PAWN, BLACK_KNIGHT, NO_PIECE, FLAG_CAPTURE);
+    assert(Evaluation::see(board, pawnTakesKnight) == 200);
+    assert(Evaluation::seeGe(board, pawnTakesKnight, 200));
+    assert(!Evaluation::seeGe(board, pawnTakesKnight, 201));
+
+    // Quiet moves run the exchange too: a check on a defended square hangs the queen
+    board.loadFEN("3rk3/8/8/8/8/8/8/3QK3 w - - 0 1");
+    Move queenCheck(D1, D7, WHITE_QUEEN, NO_PIECE, NO_PIECE, FLAG_NONE);
+    assert(MoveGenerator::givesCheck(board, queenCheck));
+    assert(Evaluation::see(board, queenCheck) == -900);
+    assert(!Evaluation::seeGe(board, queenCheck, 0));
+    assert(Evaluation::seeGe(board, queenCheck, -900));
+
+    // A check from a square nothing attacks loses nothing
+    board.loadFEN("4k3/8/8/8/8/8/8/R3K3 w - - 0 1");
+    Move rookCheck(A1, A8, WHITE_ROOK, NO_PIECE, NO_PIECE, FLAG_NONE);
+    assert(Evaluation::see(board, rookCheck) == 0);
+    assert(Evaluation::seeGe(board, rookCheck, 0));
+    assert(!Evaluation::seeGe(board, rookCheck, 1));
+
+    std::cout << "Static exchange evaluation test passed.\n\n";
+}
+
+void testActivity() {
+    Board board;
+
+    // Mirrored positions: the activity of both sides cancels out
+    board.loadFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(Evaluation::activityScore(board) == 0);
+    board.loadFEN("r1bqkb1r/pppp1ppp/2n2n2/4p3/4P3/2N2N2/PPPP1PPP/R1BQKB1R w KQkq - 0 1");
+    assert(Evaluation::activityScore(board) == 0);
+
+    // A centralized knight attacks more squares than one in the corner
+    board.loadFEN("4k3/8/8/8/3N4/8/8/4K2n w - - 0 1");
+    assert(Evaluation::activityScore(board) > 0);
+
+    // Squares attacked by enemy pawns do not count: the bishop of e3 is boxed in by the pawns
+    board.loadFEN("4k3/8/8/2p1p3/8/4B3/8/4K1b1 w - - 0 1");
+    int boxedIn = Evaluation::activityScore(board);
+    board.loadFEN("4k3/8/8/8/8/4B3/8/4K1b1 w - - 0 1");
+    assert(boxedIn < Evaluation::activityScore(board));
+
+    // King pressure needs two attackers: queen and rook together score more than each one alone
+    board.loadFEN("6k1/5ppp/8/7Q/8/8/8/4K1R1 w - - 0 1");
+    int queenAndRook = Evaluation::activityScore(board);
+    board.loadFEN("6k1/5ppp/8/7Q/8/8/8/4K3 w - - 0 1");
+    int queenOnly = Evaluation::activityScore(board);
+    board.loadFEN("6k1/5ppp/8/8/8/8/8/4K1R1 w - - 0 1");
+    int rookOnly = Evaluation::activityScore(board);
+    assert(queenAndRook > queenOnly + rookOnly);
+
+    std::cout << "Activity (mobility and king safety) test passed.\n\n";
+}
+
+// Walks the move tree a few plies deep: the score and phase makeMove keeps up to date always equal
+// the ones computed from scratch (captures, castling, en passant and promotions included), the pawn key too
+static void checkPsqtTree(const Board& board, int depth, int& positions) {
+    if (depth == 0) {
+        return;
+    }
+    MoveGenerator moveGenerator;
+    std::vector<Move> moves;
+    moveGenerator.generateAllLegalMoves(board, moves);
+    for (const Move& move : moves) {
+        Board child = board;
+        child.makeMove(move);
+        Board recomputed = child;
+        recomputed.computePsqt();
+        recomputed.computeHash();
+        assert(child.psqt == recomputed.psqt);
+        assert(child.phase == recomputed.phase);
+        assert(child.pawn_key == recomputed.pawn_key);
+        positions++;
+        checkPsqtTree(child, depth - 1, positions);
+    }
+}
+
+void testIncrementalPsqt() {
+    Board board;
+    int positions = 0;
+    board.loadFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    checkPsqtTree(board, 3, positions);
+    board.loadFEN("n1n5/PPPk4/8/8/8/8/4Kppp/5N1N b - - 0 1"); // Promotions
+    checkPsqtTree(board, 3, positions);
+    board.loadFEN("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"); // En passant
+    checkPsqtTree(board, 4, positions);
+
+    // Mirrored positions score zero, and the opening is the full phase
+    board.loadFEN("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
+    assert(board.psqt == 0 && board.phase == Evaluation::MAX_PHASE);
+
+    // Packing keeps negative values of both halves
+    int packed = makeScore(-37, 52) - makeScore(20, 80);
+    assert(mgValue(packed) == -57 && egValue(packed) == -28);
+
+    std::cout << "Incremental piece-square score test passed (" << positions << " positions).\n\n";
+}
+
+void testPawnHashTable() {
+    PawnHashTable* table = new PawnHashTable(); // Too large for the stack
+    table->clear();
+    Board board;
+    board.loadFEN("4k3/1p3p2/p7/3P4/8/6P1/PP6/4K3 w - - 0 1");
+
+    // The cached evaluation is the one computed from scratch
+    int uncached = Evaluation::evaluatePosition(board);
+    assert(Evaluation::evaluatePosition(board, table) == uncached);
+    assert(table->probes() == 1 && table->hits() == 0);
+    assert(Evaluation::evaluatePosition(board, table) == uncached);
+    assert(table->hits() == 1);
+
+    // A king move keeps the pawn structure, so the entry is found again
+    Board kingMoved = board;
+    kingMoved.makeMove(Move(E1, D2, WHITE_KING, NO_PIECE, NO_PIECE, 0));
+    assert(kingMoved.pawn_key == board.pawn_key);
+    Evaluation::evaluatePosition(kingMoved, table);
+    assert(table->probes() == 3 && table->hits() == 2);
+
+    // The entry holds the pawn bitboards of the structure
+    const PawnEntry& entry = table->probe(board);
+    assert(entry.passed[WHITE] == (1ULL << D5));
+    assert(entry.passed[BLACK] == 0ULL);
+    assert(get_bit(entry.attacks[WHITE], C6) && get_bit(entry.attacks[WHITE], E6));
+    assert(get_bit(entry.attack_span[BLACK], B4) && !get_bit(entry.attack_span[BLACK], B7));
+
+    // The passed pawns found from the spans are the ones of the per-pawn test
+    const char* fens[] = {"4k3/1p3p2/p7/3P4/8/6P1/PP6/4K3 w - - 0 1",
+                          "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+                          "4k3/p1p3p1/1P6/2P4p/P6P/8/5p2/4K3 b - - 0 1"};
+    for (const char* fen : fens) {
+        board.loadFEN(fen);
+        PawnEntry computed;
+        Evaluation::evaluatePawns(board, computed);
+        for (int square = 0; square < 64; ++square) {
+            for (int side = WHITE; side <= BLACK; ++side) {
+                bool pawn = get_bit(board.bitboards[side == WHITE ? WHITE_PAWN : BLACK_PAWN], square);
+                bool passed = pawn && Evaluation::isPassedPawn(board, square, side);
+                assert(get_bit(computed.passed[side], square) == passed);
+            }
+        }
+    }
+
+    delete table;
+    std::cout << "Pawn hash table test passed.\n\n";
+}
+
+// The packed pawn structure score of White in the position
+int whitePawnStructure(const Board& board) {
+    PawnEntry entry;
+    Evaluation::evaluatePawns(board, entry);
+    return Evaluation::scorePawnStructure(board, WHITE, entry.passed[WHITE]);
+}
+
+// Isolated (-15) and doubled (-20) pawns that are not passed lose centipawns in the packed pawn structure score
+void testPawnPenalties() {
+    Board board;
+
+    // Black's pawns keep White's from being passed. a2 and b2 support each other
+    board.loadFEN("4k3/ppp5/8/8/8/8/PP6/4K3 w - - 0 1");
+    assert(whitePawnStructure(board) == 0);
+
+    // a2 and c2 are both isolated
+    board.loadFEN("4k3/ppp5/8/8/8/8/P1P5/4K3 w - - 0 1");
+    int score = whitePawnStructure(board);
+    assert(mgValue(score) == -30 && egValue(score) == -30);
+
+    // b2 and b3 are doubled, and isolated too
+    board.loadFEN("4k3/ppp5/8/8/8/1P6/1P6/4K3 w - - 0 1");
+    score = whitePawnStructure(board);
+    assert(mgValue(score) == -70 && egValue(score) == -70);
+
+    // The whole evaluation sees the difference
+    board.loadFEN("4k3/ppp5/8/8/8/8/PP6/4K3 w - - 0 1");
+    int healthy = Evaluation::evaluatePosition(board);
+    board.loadFEN("4k3/ppp5/8/8/8/8/P1P5/4K3 w - - 0 1");
+    assert(Evaluation::evaluatePosition(board) < healthy);
+
+    std::cout << "Pawn penalties test passed.\n\n";
+}
@@ -169,6 +169,11 @@ void testFiftyMoveRule();
 void testCombinationRules();
 void testNoRepetitionNoFiftyMove();
 
+void testNullMove();
+void testIncrementalHash();
+void testGivesCheck();
+void testUpcomingRepetition();
+
 void run3fold50moveTests(){
     testThreefoldRepetition();
     testFiftyMoveRule();
@@ -188,10 +193,14 @@ int main() {
     // runPawnTests();
     // testCastlingMoves();
     // testGenerateCaptureMoves();
-    // run3fold50moveTests();
+    run3fold50moveTests();
     // testKingMoveIntoCheck();
     // testEnPassant();
     testEnemyKingMoves();
+    testNullMove();
+    testIncrementalHash();
+    testGivesCheck();
+    testUpcomingRepetition();
     return 0;
 }
 
@@ -1207,7 +1216,6 @@ void testThreefoldRepetition() {
     board.resetBoard();
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 1;
 
     // Example: Repeating a simple position
     // White King on e1, White Rook on h1
@@ -1218,9 +1226,9 @@ void testThreefoldRepetition() {
     setPiece(board, "e8", BLACK_KING);
     setPiece(board, "a8", BLACK_ROOK);
     board.side = WHITE;
+    board.castling_rights = 0; // The rooks are off their home squares, the first rook move would change the rights
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 2; // Initial position occurred twice
 
     // Move 1: White Rook h1-h2
     applyMove(board, "h1h2");
@@ -1261,7 +1269,6 @@ void testFiftyMoveRule() {
     board.resetBoard();
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 1;
 
     // Example: Making 100 non-capturing, non-pawn moves
     // For simplicity, move a knight back and forth without captures or pawn moves
@@ -1271,7 +1278,6 @@ void testFiftyMoveRule() {
     board.side = WHITE;
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 2;
     // Define a sequence of moves that do not involve pawn moves or captures
     std::vector<std::string> moves = {
         "b1c3", "b8c6",
@@ -1309,7 +1315,6 @@ void testCombinationRules() {
     board.resetBoard();
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 1;
 
     // Set up a simple position
     setPiece(board, "e1", WHITE_KING);
@@ -1317,9 +1322,9 @@ void testCombinationRules() {
     setPiece(board, "e8", BLACK_KING);
     setPiece(board, "a8", BLACK_ROOK);
     board.side = WHITE;
+    board.castling_rights = 0; // The rooks are off their home squares, the first rook move would change the rights
     board.computeHash();
     board.updateRepetitionHistory(Move());
-    board.repetition_counts[board.hash_key] = 2;
 
     // Define a sequence of non-pawn, non-capturing moves that repeat the position
     std::vector<std::string> moves = {
@@ -1359,6 +1364,7 @@ void testNoRepetitionNoFiftyMove() {
     setPiece(board, "e1", WHITE_KING);
     setPiece(board, "e8", BLACK_KING);
     board.side = WHITE;
+    board.castling_rights = 0;
 
     // Compute the initial hash and add it to the repetition history
     board.computeHash();
@@ -1378,4 +1384,118 @@ void testNoRepetitionNoFiftyMove() {
     assert(!board.isFiftyMoveRule());
 
     std::cout << "Test 4: No Repetition and No 50-Move Rule Passed.\n\n";
-}
\ No newline at end of file
+}
+
+// Null move: only the side to move, the en passant square and the hash change
+void testNullMove() {
+    Board board;
+    board.loadFEN("rnbqkbnr/ppp1pppp/8/8/3pP3/8/PPPP1PPP/RNBQKBNR b KQkq e3 0 3");
+    board.computeHash();
+
+    U64 hash_before = board.hash_key;
+    std::string fen_before = board.generateFEN();
+
+    board.makeNullMove();
+    assert(board.side == WHITE);
+    assert(board.en_passant == NO_SQUARE);
+    assert(board.hash_key != hash_before);
+
+    // The hash after a null move must match a hash computed from scratch
+    U64 incremental_hash = board.hash_key;
+    board.computeHash();
+    assert(board.hash_key == incremental_hash);
+
+    board.unmakeNullMove();
+    assert(board.hash_key == hash_before);
+    assert(board.generateFEN() == fen_before);
+
+    std::cout << "Null Move Test Passed.\n\n";
+}
+
+void testIncrementalHash() {
+    // Positions with castling, en passant and promotions available
+    const std::vector<std::string> fens = {
+        "r3k2r/pppq1ppp/2n2n2/3pp3/3PP3/2N2N2/PPPQ1PPP/R3K2R w KQkq - 0 1",
+        "rnbqkbnr/ppp1p1pp/8/3pPp2/8/8/PPPP1PPP/RNBQKBNR w KQkq f6 0 3",
+        "1r2k3/2P5/8/8/8/8/5p2/4K1R1 b - - 0 1",
+    };
+    MoveGenerator moveGenerator;
+
+    for (const std::string& fen : fens) {
+        Board board;
+        board.loadFEN(fen);
+        std::vector<Move> move_list;
+        moveGenerator.generateAllLegalMoves(board, move_list);
+
+        for (const Move& move : move_list) {
+            Board tempBoard = board;
+            tempBoard.makeMove(move);
+            U64 incremental_hash = tempBoard.hash_key;
+            tempBoard.computeHash();
+            assert(tempBoard.hash_key == incremental_hash);
+        }
+    }
+
+    std::cout << "Incremental Hash Test Passed.\n\n";
+}
+
+void testGivesCheck() {
+    const std::vector<std::string> fens = {
+        "r3k2r/pppq1ppp/2n2n2/3pp3/1b1PP3/2N2N2/PPPQ1PPP/R3K2R w KQkq - 0 1",
+        "4k3/8/8/3pP3/8/8/8/B3K2R w K d6 0 1",
+        "3r1k2/2P5/8/8/8/8/8/R3K3 w Q - 0 1",
+    };
+    MoveGenerator moveGenerator;
+
+    // givesCheck must agree with playing the move and looking at the enemy king
+    for (const std::string& fen : fens) {
+        Board board;
+        board.loadFEN(fen);
+        std::vector<Move> move_list;
+        moveGenerator.generateAllLegalMoves(board, move_list);
+
+        for (const Move& move : move_list) {
+            Board tempBoard = board;
+            tempBoard.makeMove(move);
+            assert(MoveGenerator::givesCheck(board, move) == MoveGenerator::isKingInCheck(tempBoard, tempBoard.side));
+        }
+    }
+
+    std::cout << "Gives Check Test Passed.\n\n";
+}
+
+void testUpcomingRepetition() {
+    Board board;
+    board.setInitialPosition();
+
+    // Every reversible knight, bishop, rook, queen and king move of both colors is in the cuckoo table
+    int entries = 0;
+    for (int i = 0; i < Board::CUCKOO_SIZE; ++i) {
+        if (Board::cuckoo_keys[i] != 0) {
+            entries++;
+        }
+    }
+    assert(entries == 3668);
+
+    assert(!board.hasUpcomingRepetition(10));
+
+    // 1. Nf3 Nf6 2. Ng1: Black can repeat the initial position with Ng8
+    board.makeMove(Move(G1, F3, WHITE_KNIGHT, NO_PIECE, NO_PIECE, FLAG_NONE));
+    board.makeMove(Move(G8, F6, BLACK_KNIGHT, NO_PIECE, NO_PIECE, FLAG_NONE));
+    assert(!board.hasUpcomingRepetition(10));
+    board.makeMove(Move(F3, G1, WHITE_KNIGHT, NO_PIECE, NO_PIECE, FLAG_NONE));
+    assert(board.hasUpcomingRepetition(10));
+    // Before the root the initial position occurred only once, which is no draw yet
+    assert(!board.hasUpcomingRepetition(1));
+
+    assert(!board.isRepetition());
+    board.makeMove(Move(F6, G8, BLACK_KNIGHT, NO_PIECE, NO_PIECE, FLAG_NONE));
+    assert(board.isRepetition());
+
+    // A pawn move makes the earlier positions unreachable
+    board.makeMove(Move(E2, E4, WHITE_PAWN, NO_PIECE, NO_PIECE, FLAG_PAWN_DOUBLE_PUSH));
+    assert(!board.isRepetition());
+    assert(!board.hasUpcomingRepetition(10));
+
+    std::cout << "Upcoming Repetition Test Passed.\n\n";
+}
@@ -0,0 +1,188 @@
+#include "board.h"
+#include "search.h"
+#include "move_picker.h"
+#include <iostream>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+// Heap allocations of the whole program, counted by replacing the global operator new
+static std::atomic<long long> allocations(0);
+
+void* operator new(std::size_t size) {
+    allocations++;
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+
+// Once the pool and its workers exist, a search (root included) does not touch the heap
+void testSearchDoesNotAllocate() {
+    SearchPool pool;
+    pool.report_summary = false;
+    pool.multi_pv = 2; // The root move sorting of the MultiPV lines too
+
+    Board middlegame, endgame;
+    middlegame.loadFEN("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1");
+    endgame.loadFEN("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1");
+    pool.findBestMove(middlegame, 1); // Warm up the output stream
+
+    long long before = allocations;
+    pool.findBestMove(middlegame, 6);
+    pool.findBestMove(endgame, 8);
+    long long searchAllocations = allocations - before;
+
+    std::cout << "Heap allocations during the searches: " << searchAllocations << "\n";
+    assert(searchAllocations == 0);
+    std::cout << "Test: Search Without Heap Allocations Passed.\n\n";
+}
+
+// Pools share nothing: two searches running at the same time give the results of one alone
+void testIndependentPools() {
+    Board board;
+    board.loadFEN("r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8");
+
+    SearchPool reference;
+    reference.report_summary = false;
+    Move referenceMove = reference.findBestMove(board, 5);
+    long long referenceNodes = reference.nodes() + reference.qnodes();
+
+    SearchPool first, second;
+    first.report_summary = false;
+    second.report_summary = false;
+    Move firstMove, secondMove;
+    std::thread firstThread([&]() { firstMove = first.findBestMove(board, 5); });
+    std::thread secondThread([&]() { secondMove = second.findBestMove(board, 5); });
+    firstThread.join();
+    secondThread.join();
+
+    assert(firstMove == referenceMove && secondMove == referenceMove);
+    assert(first.nodes() + first.qnodes() == referenceNodes);
+    assert(second.nodes() + second.qnodes() == referenceNodes);
+    std::cout << "Test: Independent Search Pools Passed.\n\n";
+}
+
+// A search without limits runs until stopped from another thread, and returns promptly once it is
+void testStopFromAnotherThread() {
+    Board board;
+    board.loadFEN("r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8");
+    SearchPool pool;
+    pool.report_summary = false;
+
+    long long searches = pool.searchesStarted();
+    Move bestMove;
+    std::thread searchThread([&]() { bestMove = pool.findBestMove(board, SearchLimits()); });
+    while (pool.searchesStarted() == searches) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    assert(pool.searching());
+
+    auto stopTime = std::chrono::steady_clock::now();
+    pool.stop();
+    searchThread.join();
+    long long latencyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - stopTime).count();
+
+    std::cout << "Stop serviced in " << latencyUs << " us\n";
+    assert(!pool.searching());
+    assert(bestMove.from_square != -1);
+    assert(latencyUs < 50000); // Generous, for loaded machines
+    std::cout << "Test: Stop From Another Thread Passed.\n\n";
+}
+
+// A ponder search that reaches its depth limit holds its result until ponderhit, which turns it into
+// a search timed from the clock
+void testPonderHitStartsClock() {
+    Board board;
+    board.loadFEN("r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R w KQ - 0 8");
+    SearchPool pool;
+    pool.report_summary = false;
+
+    SearchLimits limits;
+    limits.depth = 3;
+    limits.ponder = true;
+    long long searches = pool.searchesStarted();
+    Move bestMove;
+    std::thread searchThread([&]() { bestMove = pool.findBestMove(board, limits); });
+    while (pool.searchesStarted() == searches) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    assert(pool.searching()); // Depth 3 is long done, the result waits for ponderhit
+    pool.ponderHit();
+    searchThread.join();
+    assert(bestMove.from_square != -1);
+
+    // Pondering with a clock: the search runs until ponderhit, then for its budget from that moment
+    // (1 s left and 30 moves to go leave about 33 ms)
+    SearchLimits clock;
+    clock.time_ms[WHITE] = clock.time_ms[BLACK] = 1000;
+    clock.ponder = true;
+    searches = pool.searchesStarted();
+    searchThread = std::thread([&]() { bestMove = pool.findBestMove(board, clock); });
+    while (pool.searchesStarted() == searches) {
+        std::this_thread::yield();
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    assert(pool.searching());
+    auto hitTime = std::chrono::steady_clock::now();
+    pool.ponderHit();
+    searchThread.join();
+    long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - hitTime).count();
+    std::cout << "Search ended " << elapsedMs << " ms after ponderhit\n";
+    assert(bestMove.from_square != -1);
+    assert(elapsedMs < 500); // Generous, for loaded machines
+    std::cout << "Test: Ponder Hit Starts Clock Passed.\n\n";
+}
+
+// A quiet queen promotion is handed out with the captures, so late move pruning skipping the quiets
+// does not drop it
+void testPromotionSurvivesSkipQuiets() {
+    Board board;
+    board.loadFEN("4k3/P7/8/8/8/8/6PP/6K1 w - - 0 1");
+    SearchPool pool;
+    std::unique_ptr<SearchWorker> worker = std::make_unique<SearchWorker>(pool, 0);
+    std::vector<Move> moves;
+    moves.reserve(MoveGenerator::MAX_MOVES);
+
+    MovePicker picker(*worker, board, moves, 0, 1);
+    picker.skipQuiets();
+    Move move;
+    bool promotionFound = false;
+    int handedOut = 0;
+    while (picker.next(move)) {
+        handedOut++;
+        if (move.from_square == A7 && move.to_square == A8 && move.promoted_piece == WHITE_QUEEN) {
+            promotionFound = true;
+        }
+    }
+    assert(promotionFound);
+    assert(handedOut == 1); // Nothing else is tactical here, the quiets were all skipped
+    std::cout << "Test: Promotion Survives Skip Quiets Passed.\n\n";
+}
+
+int main() {
+    Search::init();
+
+    testSearchDoesNotAllocate();
+    testIndependentPools();
+    testStopFromAnotherThread();
+    testPonderHitStartsClock();
+    testPromotionSurvivesSkipQuiets();
+
+    std::cout << "All search tests completed.\n";
+    return 0;
+}